@@ -0,0 +1,648 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice, this
+ *   list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright notice,
+ *   this list of conditions and the following disclaimer in the documentation
+ *   and/or other materials provided with the distribution.
+ * - Neither the name of Blue Brain Project / EPFL nor the names of its
+ *   contributors may be used to endorse or promote products derived from this
+ *   software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <rockets/helpers.h>
+#include <rockets/http/client.h>
+#include <rockets/http/helpers.h>
+#include <rockets/jsonrpc/helpers.h>
+#include <rockets/server.h>
+#include <rockets/ws/client.h>
+
+#include "rockets/json.hpp"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace rockets;
+
+namespace
+{
+const auto wsProtocol = "rockets-benchmark";
+using Clock = std::chrono::high_resolution_clock;
+
+struct Options
+{
+    std::vector<unsigned int> threads{1, 2, 4, 8};
+    std::vector<unsigned int> contexts{1, 2, 4, 8};
+    size_t clients = 64;
+    size_t connections = 5000;
+    size_t messages = 1000;
+    size_t size = 1024;
+    size_t routes = 1000;
+};
+
+std::vector<unsigned int> parseList(const std::string& list)
+{
+    std::vector<unsigned int> values;
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ','))
+        values.push_back(std::stoul(value));
+    return values;
+}
+
+Options parseOptions(const std::vector<std::string>& args)
+{
+    Options options;
+    for (size_t i = 0; i + 1 < args.size(); i += 2)
+    {
+        const auto& key = args[i];
+        const auto& value = args[i + 1];
+        if (key == "--threads")
+            options.threads = parseList(value);
+        else if (key == "--contexts")
+            options.contexts = parseList(value);
+        else if (key == "--connections")
+            options.connections = std::stoul(value);
+        else if (key == "--clients")
+            options.clients = std::stoul(value);
+        else if (key == "--messages")
+            options.messages = std::stoul(value);
+        else if (key == "--size")
+            options.size = std::stoul(value);
+        else if (key == "--routes")
+            options.routes = std::stoul(value);
+        else
+            throw std::invalid_argument("unknown option: " + key);
+    }
+    return options;
+}
+
+/**
+ * Websocket clients serviced by a few threads, counting received messages.
+ *
+ * Text messages are answered with the result of the optional reply function.
+ */
+class ClientPool
+{
+public:
+    using ReplyFunc = std::function<std::string(const std::string&)>;
+
+    ClientPool(const std::string& uri, const size_t count,
+               ReplyFunc reply = ReplyFunc(),
+               const ws::ClientOptions& options = ws::ClientOptions())
+    {
+        const auto threadCount =
+            std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+        _clients.resize(threadCount);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto client = std::make_unique<ws::Client>(options);
+            client->handleText([this, reply](const ws::Request& request) {
+                ++received;
+                return reply ? reply(request.message) : std::string();
+            });
+            client->handleBinary([this](const ws::Request&) {
+                ++received;
+                return "";
+            });
+            auto future = client->connect(uri, wsProtocol);
+            while (!is_ready(future))
+                client->process(10);
+            future.get();
+            _clients[i % threadCount].push_back(std::move(client));
+        }
+        // waiting for events leaves the CPU to the server being measured
+        for (auto& clients : _clients)
+            _threads.emplace_back([this, &clients] {
+                while (_running)
+                    for (auto& client : clients)
+                        client->process(1);
+            });
+    }
+
+    ~ClientPool()
+    {
+        _running = false;
+        for (auto& thread : _threads)
+            thread.join();
+    }
+
+    void waitFor(const size_t count) const
+    {
+        while (received < count)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    std::atomic<size_t> received{0};
+
+private:
+    std::vector<std::vector<std::unique_ptr<ws::Client>>> _clients;
+    std::vector<std::thread> _threads;
+    std::atomic<bool> _running{true};
+};
+
+void waitForConnections(const Server& server, const size_t count)
+{
+    while (server.getConnectionCount() < count)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+/** Throughput of broadcastText() to many clients for each thread count. */
+void benchmarkBroadcast(const Options& options)
+{
+    const std::string message(options.size, 'a');
+    std::cout << "broadcast: " << options.clients << " clients, "
+              << options.messages << " messages of " << options.size
+              << " bytes" << std::endl;
+
+    for (const auto threads : options.threads)
+    {
+        Server server{"", wsProtocol, std::max(1u, threads)};
+        ClientPool clients{server.getURI(), options.clients};
+        waitForConnections(server, options.clients);
+
+        const auto start = Clock::now();
+        for (size_t i = 0; i < options.messages; ++i)
+            server.broadcastText(message);
+        clients.waitFor(options.clients * options.messages);
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        const auto total = options.clients * options.messages;
+        std::cout << "  " << server.getThreadCount() << " service threads: "
+                  << static_cast<size_t>(total / elapsed.count()) << " msg/s"
+                  << std::endl;
+    }
+}
+
+/** Rate of new websocket connections for each number of server contexts. */
+void benchmarkConnect(const Options& options)
+{
+    const auto clientThreads =
+        std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    std::cout << "connect: " << options.connections << " connections from "
+              << clientThreads << " threads" << std::endl;
+
+    for (const auto contexts : options.contexts)
+    {
+        ServerOptions serverOptions;
+        serverOptions.name = wsProtocol;
+        serverOptions.threadCount = 1;
+        serverOptions.contextCount = contexts;
+        Server server{serverOptions};
+        const auto uri = server.getURI();
+
+        std::atomic<size_t> failed{0};
+        std::vector<std::thread> threads;
+        const auto start = Clock::now();
+        for (unsigned int i = 0; i < clientThreads; ++i)
+        {
+            threads.emplace_back([&, i] {
+                for (size_t j = i; j < options.connections; j += clientThreads)
+                {
+                    ws::Client client;
+                    auto future = client.connect(uri, wsProtocol);
+                    while (!is_ready(future))
+                        client.process(1);
+                    try
+                    {
+                        future.get();
+                    }
+                    catch (const std::exception&)
+                    {
+                        ++failed;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        const std::chrono::duration<double> elapsed = Clock::now() - start;
+
+        const auto connected = options.connections - failed;
+        std::cout << "  " << contexts << " contexts: "
+                  << static_cast<size_t>(connected / elapsed.count())
+                  << " connections/s";
+        if (failed > 0)
+            std::cout << " (" << failed << " failed)";
+        std::cout << std::endl;
+    }
+}
+
+std::string makeTimestamp()
+{
+    using namespace std::chrono;
+    return std::to_string(
+        duration_cast<nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+double getMicrosecondsSince(const std::string& timestamp)
+{
+    using namespace std::chrono;
+    const Clock::time_point start{nanoseconds{std::stoll(timestamp)}};
+    return duration<double, std::micro>(Clock::now() - start).count();
+}
+
+void printLatencies(std::vector<double>& latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    const auto percentile = [&latencies](const double p) {
+        return latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+    };
+    std::cout << "p50 " << percentile(0.5) << " us, p90 " << percentile(0.9)
+              << " us, p99 " << percentile(0.99) << " us, p99.9 "
+              << percentile(0.999) << " us, max " << latencies.back() << " us"
+              << std::endl;
+}
+
+/**
+ * Round-trip latency distribution of websocket messages with unpinned and
+ * pinned service threads (one core per thread).
+ */
+void benchmarkAffinity(const Options& options)
+{
+    const auto coreCount = std::max(1u, std::thread::hardware_concurrency());
+    const auto total = options.clients * options.messages;
+    std::cout << "affinity: " << options.clients << " clients, "
+              << options.messages << " round trips per client" << std::endl;
+
+    for (const auto threads : options.threads)
+    {
+        for (const bool pinned : {false, true})
+        {
+            ServerOptions serverOptions;
+            serverOptions.name = wsProtocol;
+            serverOptions.threadCount = std::max(1u, threads);
+            if (pinned)
+            {
+                for (unsigned int i = 0; i < serverOptions.threadCount; ++i)
+                    serverOptions.affinity.push_back({i % coreCount});
+                serverOptions.numaLocalMemory = true;
+            }
+            std::mutex mutex;
+            std::vector<double> latencies;
+            latencies.reserve(total);
+            std::atomic<size_t> samples{0};
+
+            // the server measures the time for its timestamp to come back and
+            // answers with a new one until enough samples are collected
+            Server server{serverOptions};
+            server.handleText([&](const ws::Request& request) {
+                const auto latency = getMicrosecondsSince(request.message);
+                std::lock_guard<std::mutex> lock{mutex};
+                if (latencies.size() >= total)
+                    return std::string();
+                latencies.push_back(latency);
+                ++samples;
+                return makeTimestamp();
+            });
+
+            const auto echo = [](const std::string& message) {
+                return message;
+            };
+            ClientPool clients{server.getURI(), options.clients, echo};
+            waitForConnections(server, options.clients);
+
+            server.broadcastText(makeTimestamp());
+            while (samples < total)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+            std::cout << "  " << server.getThreadCount() << " service threads, "
+                      << (pinned ? "pinned: " : "unpinned: ");
+            std::lock_guard<std::mutex> lock{mutex};
+            printLatencies(latencies);
+        }
+    }
+}
+
+/** A pretty-printed JSON-RPC notification, as sent by jsonrpc::Notifier. */
+std::string makeJsonNotification(const size_t index)
+{
+    const auto value = static_cast<double>(index);
+    const rockets_nlohmann::json params{
+        {"frame", index},
+        {"progress", value / 1000.0},
+        {"state", "rendering"},
+        {"camera",
+         {{"position", {1.5 * value, -2.25, 10.0 + value / 7.0}},
+          {"orientation", {0.0, 0.7071, 0.0, 0.7071}},
+          {"target", {0.0, 0.0, 0.0}}}},
+        {"statistics", {{"fps", 60.0 - value / 100.0}, {"triangles", 2048}}}};
+    return jsonrpc::makeNotification("progress", params.dump(4));
+}
+
+/** @return the CPU time used by the calling thread. */
+double getThreadCpuSeconds()
+{
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return static_cast<double>(time.tv_sec) + 1e-9 * time.tv_nsec;
+}
+
+/**
+ * Compress the messages like permessage-deflate does: one raw deflate stream
+ * for the connection, each message ending with a sync flush whose 4 bytes
+ * trailer is not sent.
+ *
+ * @return the number of compressed bytes.
+ */
+size_t deflateMessages(const std::vector<std::string>& messages,
+                       const int level, const int windowBits)
+{
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (deflateInit2(&stream, level, Z_DEFLATED, -windowBits, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+
+    std::vector<unsigned char> buffer(64 * 1024);
+    size_t compressed = 0;
+    for (const auto& message : messages)
+    {
+        stream.next_in = (Bytef*)message.data();
+        stream.avail_in = static_cast<uInt>(message.size());
+        do
+        {
+            stream.next_out = buffer.data();
+            stream.avail_out = static_cast<uInt>(buffer.size());
+            deflate(&stream, Z_SYNC_FLUSH);
+            compressed += buffer.size() - stream.avail_out;
+        } while (stream.avail_out == 0);
+        compressed -= 4;
+    }
+    deflateEnd(&stream);
+    return compressed;
+}
+
+/**
+ * CPU cost and bytes saved by compressing JSON-RPC notifications, with zlib
+ * alone for each level and window size, then end-to-end with broadcasts.
+ */
+void benchmarkCompression(const Options& options)
+{
+    std::vector<std::string> messages;
+    size_t raw = 0;
+    for (size_t i = 0; i < options.messages; ++i)
+    {
+        messages.push_back(makeJsonNotification(i));
+        raw += messages.back().size();
+    }
+    std::cout << "compression: " << options.messages
+              << " JSON-RPC notifications, " << raw / options.messages
+              << " bytes on average" << std::endl;
+
+    for (const int windowBits : {10, 15})
+    {
+        for (const int level : {1, 6, 9})
+        {
+            const auto start = getThreadCpuSeconds();
+            const auto compressed =
+                deflateMessages(messages, level, windowBits);
+            const auto cpu = getThreadCpuSeconds() - start;
+            std::cout << "  level " << level << ", window bits " << windowBits
+                      << ": ratio " << double(raw) / compressed << ", "
+                      << 1e6 * cpu / options.messages << " us CPU/message, "
+                      << (raw - compressed) / (1024 * 1024 * cpu)
+                      << " MB saved per CPU second" << std::endl;
+        }
+    }
+
+    for (const bool enabled : {false, true})
+    {
+        ServerOptions serverOptions;
+        serverOptions.name = wsProtocol;
+        serverOptions.threadCount = 1;
+        serverOptions.compression.enabled = enabled;
+        Server server{serverOptions};
+
+        // the service thread reads its own CPU time when the probe asks
+        std::atomic<double> serverCpu{0.0};
+        std::atomic<bool> serverCpuRead{false};
+        std::set<uintptr_t> probeID;
+        server.handleText([&](const ws::Request& request) {
+            probeID = {request.clientID};
+            serverCpu = getThreadCpuSeconds();
+            serverCpuRead = true;
+            return std::string();
+        });
+        ws::Client probe;
+        auto connected = probe.connect(server.getURI(), wsProtocol);
+        while (!is_ready(connected))
+            probe.process(10);
+        connected.get();
+        const auto readServerCpu = [&] {
+            serverCpuRead = false;
+            probe.sendText("cpu");
+            while (!serverCpuRead)
+                probe.process(1);
+            return serverCpu.load();
+        };
+
+        ws::ClientOptions clientOptions;
+        clientOptions.compression = serverOptions.compression;
+        ClientPool clients{server.getURI(), options.clients, {}, clientOptions};
+        waitForConnections(server, options.clients + 1);
+
+        const auto start = readServerCpu();
+        for (const auto& message : messages)
+            server.broadcastText(message, probeID);
+        clients.waitFor(options.clients * options.messages);
+        const auto cpu = readServerCpu() - start;
+
+        std::cout << "  broadcast to " << options.clients << " clients, "
+                  << (enabled ? "compressed: " : "uncompressed: ")
+                  << 1e6 * cpu / (options.clients * options.messages)
+                  << " us CPU/message (service thread)" << std::endl;
+    }
+}
+
+/** The previous endpoint lookup: prefix scan of the endpoints, in reverse. */
+class LinearRouter
+{
+public:
+    void add(const std::string& endpoint) { _endpoints.insert(endpoint); }
+
+    bool find(const std::string& path) const
+    {
+        return std::find_if(_endpoints.begin(), _endpoints.end(),
+                            [&path](const std::string& endpoint) {
+                                return path.compare(0, endpoint.size(),
+                                                    endpoint) == 0;
+                            }) != _endpoints.end();
+    }
+
+private:
+    std::set<std::string, std::greater<std::string>> _endpoints;
+};
+
+template <typename Func>
+double getNanosecondsPerCall(const size_t count, Func func)
+{
+    const auto start = Clock::now();
+    for (size_t i = 0; i < count; ++i)
+        func(i);
+    const auto elapsed = Clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / count;
+}
+
+std::vector<std::string> addRoutes(const size_t count,
+                                   std::function<void(const std::string&)> add)
+{
+    std::vector<std::string> paths;
+    for (size_t i = 0; i < count; ++i)
+    {
+        const auto resource = "api/v1/resource" + std::to_string(i);
+        add(resource);
+        add(resource + "/items/");
+        paths.push_back(resource);
+        paths.push_back(resource + "/items/42");
+    }
+    return paths;
+}
+
+/**
+ * CPU time of the service thread per HTTP request with one route and with
+ * many, through Server::handle(), and lookup time of the former linear prefix
+ * scan of the endpoints for comparison.
+ */
+void benchmarkRouter(const Options& options)
+{
+    std::cout << "router: " << options.messages << " requests" << std::endl;
+    for (const auto routes : {size_t(1), options.routes})
+    {
+        ServerOptions serverOptions;
+        serverOptions.threadCount = 1;
+        Server server{serverOptions};
+
+        // read by the service thread which handles the requests
+        std::atomic<double> serverCpu{0.0};
+        const auto func = [&serverCpu](const http::Request&) {
+            serverCpu = getThreadCpuSeconds();
+            return http::make_ready_response(http::Code::OK);
+        };
+        auto paths = addRoutes(routes, [&](const std::string& endpoint) {
+            server.handle(http::Method::GET, endpoint, func);
+        });
+        server.handle(http::Method::GET, "api/v2/users/{id}/posts/{post}",
+                      func);
+        paths.push_back("api/v2/users/42/posts/7");
+
+        http::Client client;
+        const auto get = [&](const std::string& path) {
+            auto response = client.request(server.getURI() + "/" + path);
+            while (!is_ready(response))
+                client.process(1);
+            if (response.get().code != http::Code::OK)
+                throw std::runtime_error("router: unexpected lookup failure");
+            return serverCpu.load();
+        };
+        const auto start = get(paths.front());
+        for (size_t i = 0; i < options.messages; ++i)
+            get(paths[i % paths.size()]);
+        const auto cpu = serverCpu - start;
+
+        std::cout << "  " << 2 * routes + 1 << " routes: "
+                  << 1e6 * cpu / options.messages
+                  << " us CPU/request (service thread)" << std::endl;
+    }
+
+    LinearRouter linear;
+    const auto paths = addRoutes(options.routes, [&](const std::string& e) {
+        linear.add(e);
+    });
+    const auto count = options.messages * paths.size();
+    size_t found = 0;
+    const auto scan = getNanosecondsPerCall(count, [&](const size_t i) {
+        found += linear.find(paths[i % paths.size()]);
+    });
+    if (found != count)
+        throw std::runtime_error("router: unexpected lookup failures");
+    std::cout << "  former linear scan of " << 2 * options.routes
+              << " routes: " << scan << " ns/lookup" << std::endl;
+}
+
+using Benchmark = std::function<void(const Options&)>;
+const std::map<std::string, Benchmark> benchmarks{
+    {"affinity", benchmarkAffinity},
+    {"broadcast", benchmarkBroadcast},
+    {"compression", benchmarkCompression},
+    {"connect", benchmarkConnect},
+    {"router", benchmarkRouter}};
+
+void print_usage()
+{
+    std::cout << "Usage: rockets-benchmark <benchmark> [options]" << std::endl
+              << "Benchmarks:" << std::endl;
+    for (const auto& benchmark : benchmarks)
+        std::cout << "  " << benchmark.first << std::endl;
+    std::cout << "Options:" << std::endl
+              << "  --threads <n,...> - service threads [1,2,4,8]"
+              << std::endl
+              << "  --contexts <n,...> - server contexts [1,2,4,8]"
+              << std::endl
+              << "  --connections <n> - new connections [5000]" << std::endl
+              << "  --clients <n> - websocket clients [64]" << std::endl
+              << "  --messages <n> - messages per client [1000]" << std::endl
+              << "  --size <bytes> - message size [1024]" << std::endl
+              << "  --routes <n> - HTTP endpoints [1000]" << std::endl;
+}
+} // anonymous namespace
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i)
+        args.emplace_back(argv[i]);
+
+    if (args.empty() || args[0] == "--help" || !benchmarks.count(args[0]))
+    {
+        print_usage();
+        return args.empty() || args[0] == "--help" ? EXIT_SUCCESS
+                                                   : EXIT_FAILURE;
+    }
+
+    try
+    {
+        const auto options = parseOptions({args.begin() + 1, args.end()});
+        benchmarks.at(args[0])(options);
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -22,6 +22,7 @@
 #include "http/utils.h"
 #include "ws/channel.h"
 #include "ws/connection.h"
+#include "ws/extensions.h"
 
 #include <sstream>
 #include <string.h> // memset
@@ -80,9 +81,13 @@ bool isNoProxyHost(const std::string& hostname)
 
 namespace rockets
 {
-ClientContext::ClientContext(lws_callback_function* callback, void* user)
-    : protocols{make_protocol(wsProtocolName.c_str(), callback, user),
+ClientContext::ClientContext(lws_callback_function* callback, void* user,
+                             const ws::ClientOptions& options)
+    : protocols{make_protocol(wsProtocolName.c_str(), callback, user,
+                              options.rxBufferSize),
                 null_protocol()}
+    , extensions{ws::getClientExtensions(options.compression, deflateOffer,
+                                         options.serverMaxWindowBits)}
 {
     memset(&info, 0, sizeof(info));
     info.port = CONTEXT_PORT_NO_LISTEN;
@@ -90,6 +95,7 @@ ClientContext::ClientContext(lws_callback_function* callback, void* user)
     info.gid = -1;
     info.uid = -1;
     info.max_http_header_data = 4096;
+    info.extensions = extensions.empty() ? nullptr : extensions.data();
 #if CLIENT_USE_EXPLICIT_VHOST
     info.options = LWS_SERVER_OPTION_EXPLICIT_VHOSTS;
 #endif
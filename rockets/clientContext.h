@@ -24,7 +24,7 @@
 #include <rockets/pollDescriptors.h>
 #include <rockets/utils.h>
 #include <rockets/wrappers.h>
-#include <rockets/ws/types.h>
+#include <rockets/ws/clientOptions.h>
 
 #include <libwebsockets.h>
 
@@ -43,7 +43,8 @@ namespace rockets
 class ClientContext
 {
 public:
-    ClientContext(lws_callback_function* callback, void* user);
+    ClientContext(lws_callback_function* callback, void* user,
+                  const ws::ClientOptions& options = ws::ClientOptions());
 
     lws* startHttpRequest(http::Method method, const std::string& uri);
 
@@ -58,6 +59,8 @@ private:
     lws_context_creation_info info;
     std::string wsProtocolName{"default"};
     std::vector<lws_protocols> protocols;
+    std::string deflateOffer;
+    std::vector<lws_extension> extensions;
     LwsContextPtr context;
 #if CLIENT_USE_EXPLICIT_VHOST
     lws_vhost* vhost = nullptr;
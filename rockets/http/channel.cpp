@@ -22,6 +22,9 @@
 #include "response.h"
 #include "utils.h"
 
+#include <cstdio>
+#include <cstring>
+
 namespace rockets
 {
 namespace http
@@ -32,6 +35,7 @@ const int HEADERS_BUFFER_SIZE = 4096;
 const int MAX_HEADER_LENGTH = 512;
 const int MAX_QUERY_PARAM_LENGTH = 4096;
 const std::string JSON_TYPE = "application/json";
+const std::string CHUNKED = "chunked";
 
 lws_token_indexes to_lws_token(const Header header)
 {
@@ -47,6 +51,18 @@ lws_token_indexes to_lws_token(const Header header)
         return WSI_TOKEN_HTTP_LOCATION;
     case Header::RETRY_AFTER:
         return WSI_TOKEN_HTTP_RETRY_AFTER;
+    case Header::ETAG:
+        return WSI_TOKEN_HTTP_ETAG;
+    case Header::IF_MODIFIED_SINCE:
+        return WSI_TOKEN_HTTP_IF_MODIFIED_SINCE;
+    case Header::IF_NONE_MATCH:
+        return WSI_TOKEN_HTTP_IF_NONE_MATCH;
+    case Header::ACCEPT_ENCODING:
+        return WSI_TOKEN_HTTP_ACCEPT_ENCODING;
+    case Header::CONTENT_ENCODING:
+        return WSI_TOKEN_HTTP_CONTENT_ENCODING;
+    case Header::VARY:
+        return WSI_TOKEN_HTTP_VARY;
     default:
         return WSI_TOKEN_COUNT; // should not happen
     }
@@ -118,6 +134,19 @@ std::map<std::string, std::string> Channel::readQueryParameters() const
     return query;
 }
 
+std::map<Header, std::string> Channel::readRequestHeaders() const
+{
+    std::map<Header, std::string> headers;
+    for (auto header : {Header::IF_MODIFIED_SINCE, Header::IF_NONE_MATCH,
+                        Header::ACCEPT_ENCODING})
+    {
+        auto value = _readHeader(to_lws_token(header));
+        if (!value.empty())
+            headers.emplace(header, std::move(value));
+    }
+    return headers;
+}
+
 CorsRequestHeaders Channel::readCorsRequestHeaders() const
 {
     CorsRequestHeaders cors;
@@ -139,6 +168,22 @@ void Channel::requestCallback()
     lws_callback_on_writable(wsi);
 }
 
+void Channel::requestDelayedCallback(const std::chrono::microseconds delay)
+{
+#if LWS_LIBRARY_VERSION_NUMBER >= 3000000
+    // LWS_CALLBACK_TIMER, which then books the writable callback
+    lws_set_timer_usecs(wsi, delay.count());
+#else
+    (void)delay;
+    requestCallback();
+#endif
+}
+
+void Channel::setReceiveEnabled(const bool enabled)
+{
+    lws_rx_flow_control(wsi, enabled ? 1 : 0);
+}
+
 int Channel::writeResponseHeaders(const CorsResponseHeaders& corsHeaders,
                                   const Response& response)
 {
@@ -150,8 +195,23 @@ int Channel::writeResponseHeaders(const CorsResponseHeaders& corsHeaders,
     if (lws_add_http_header_status(wsi, response.code, &p, end))
         return 1;
 
-    if (lws_add_http_header_content_length(wsi, response.body.size(), &p, end))
-        return 1;
+    if (response.producer && response.producerSize == 0)
+    {
+        const auto value = (const unsigned char*)CHUNKED.c_str();
+        const auto size = static_cast<int>(CHUNKED.size());
+        if (lws_add_http_header_by_token(wsi, WSI_TOKEN_HTTP_TRANSFER_ENCODING,
+                                         value, size, &p, end))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        const auto length =
+            response.producer ? response.producerSize : response.body.size();
+        if (lws_add_http_header_content_length(wsi, length, &p, end))
+            return 1;
+    }
 
     for (const auto& header : response.headers)
     {
@@ -182,7 +242,7 @@ int Channel::writeResponseHeaders(const CorsResponseHeaders& corsHeaders,
     if (n < 0)
         return -1;
 
-    if (!response.body.empty())
+    if (!response.body.empty() || response.producer)
     {
         // Only one lws_write() allowed, book another callback for sending body
         requestCallback();
@@ -202,6 +262,27 @@ int Channel::writeResponseBody(const Response& response)
     return lws_http_transaction_completed(wsi) ? -1 : 0;
 }
 
+int Channel::writeResponseChunk(unsigned char* data, const size_t size)
+{
+    // frame the data in place: "<hex size>\r\n<data>\r\n", the empty last
+    // chunk "0\r\n\r\n" terminates the body (RFC 7230 section 4.1)
+    char header[chunkPrefixSize - LWS_PRE + 1];
+    const auto headerSize = static_cast<size_t>(
+        snprintf(header, sizeof(header), "%zx\r\n", size));
+    unsigned char* const start = data - headerSize;
+    std::memcpy(start, header, headerSize);
+    std::memcpy(data + size, "\r\n", chunkSuffixSize);
+
+    return _writeResponsePart(start, headerSize + size + chunkSuffixSize,
+                              size == 0);
+}
+
+int Channel::writeResponseData(unsigned char* data, const size_t size,
+                               const bool last)
+{
+    return _writeResponsePart(data, size, last);
+}
+
 #if LWS_LIBRARY_VERSION_NUMBER >= 2001000
 int Channel::writeRequestBody(const std::string& body)
 {
@@ -224,7 +305,8 @@ Response::Headers Channel::readResponseHeaders() const
     Response::Headers headers;
     for (auto header :
          {Header::ALLOW, Header::CONTENT_TYPE, Header::LAST_MODIFIED,
-          Header::LOCATION, Header::RETRY_AFTER})
+          Header::LOCATION, Header::RETRY_AFTER, Header::ETAG,
+          Header::CONTENT_ENCODING, Header::VARY})
     {
         auto value = _readHeader(to_lws_token(header));
         if (!value.empty())
@@ -233,6 +315,11 @@ Response::Headers Channel::readResponseHeaders() const
     return headers;
 }
 
+bool Channel::isResponseChunked() const
+{
+    return _readHeader(WSI_TOKEN_HTTP_TRANSFER_ENCODING) == CHUNKED;
+}
+
 int Channel::writeRequestHeader(const std::string& body, unsigned char** buffer,
                                 const size_t bufferSize)
 {
@@ -278,6 +365,24 @@ std::string Channel::_readHeader(const lws_token_indexes token) const
     return std::string(buf, (size_t)(length - 1));
 }
 
+int Channel::_writeResponsePart(unsigned char* data, const size_t size,
+                                const bool last)
+{
+    const auto protocol = last ? LWS_WRITE_HTTP_FINAL : LWS_WRITE_HTTP;
+    if (lws_write(wsi, data, size, protocol) < 0)
+        return -1;
+
+    if (!last)
+    {
+        // Only one lws_write() allowed, book another callback for next part
+        requestCallback();
+        return 0;
+    }
+
+    // Close and free connection if complete, else keep open
+    return lws_http_transaction_completed(wsi) ? -1 : 0;
+}
+
 bool Channel::_write(const std::string& message, lws_write_protocol protocol)
 {
     auto buffer = std::string(LWS_PRE, '\0');
@@ -27,6 +27,8 @@
 
 #include <libwebsockets.h>
 
+#include <chrono>
+
 namespace rockets
 {
 namespace http
@@ -40,9 +42,19 @@ namespace http
 class Channel
 {
 public:
+    /**
+     * Space to reserve before the data given to writeResponseChunk(), which
+     * covers the LWS_PRE needed before the data of writeResponseData().
+     */
+    static const size_t chunkPrefixSize = LWS_PRE + 18;
+    /** Space to reserve after the data given to writeResponseChunk(). */
+    static const size_t chunkSuffixSize = 2;
+
     explicit Channel(lws* wsi);
     Channel() = default;
 
+    lws* getWsi() const { return wsi; }
+
     /* Client + Server */
     size_t readContentLength() const;
 
@@ -51,11 +63,16 @@ public:
     Method readMethod() const;
     std::string readOrigin() const;
     std::map<std::string, std::string> readQueryParameters() const;
+    std::map<Header, std::string> readRequestHeaders() const;
     CorsRequestHeaders readCorsRequestHeaders() const;
     void requestCallback();
+    void requestDelayedCallback(std::chrono::microseconds delay);
+    void setReceiveEnabled(bool enabled);
     int writeResponseHeaders(const CorsResponseHeaders& corsHeaders,
                              const Response& response);
     int writeResponseBody(const Response& response);
+    int writeResponseChunk(unsigned char* data, size_t size);
+    int writeResponseData(unsigned char* data, size_t size, bool last);
 
     /* Client */
     int writeRequestHeader(const std::string& body, unsigned char** buffer,
@@ -65,12 +82,14 @@ public:
     Code readResponseCode() const;
 #endif
     Response::Headers readResponseHeaders() const;
+    bool isResponseChunked() const;
 
 private:
     lws* wsi = nullptr;
 
     std::string _readHeader(lws_token_indexes token) const;
     void _writeResponseBody(const std::string& message);
+    int _writeResponsePart(unsigned char* data, size_t size, bool last);
     bool _write(const std::string& message, lws_write_protocol protocol);
 };
 } // namespace http
@@ -0,0 +1,265 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "compressor.h"
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+namespace rockets
+{
+namespace http
+{
+namespace
+{
+const std::string ACCEPT_ENCODING = "Accept-Encoding";
+
+enum class Encoding
+{
+    identity,
+    gzip,
+    deflate
+};
+
+const char* to_string(const Encoding encoding)
+{
+    return encoding == Encoding::gzip ? "gzip" : "deflate";
+}
+
+std::string _toLower(std::string value)
+{
+    std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+    return value;
+}
+
+std::string _trim(const std::string& value)
+{
+    const auto begin = value.find_first_not_of(" \t");
+    if (begin == std::string::npos)
+        return std::string();
+    const auto end = value.find_last_not_of(" \t");
+    return value.substr(begin, end - begin + 1);
+}
+
+// @return the quality values of the codings, "*" included (RFC 7231 5.3.4)
+std::map<std::string, double> _parseAcceptEncoding(const std::string& header)
+{
+    std::map<std::string, double> codings;
+    std::istringstream stream{header};
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        const auto semicolon = item.find(';');
+        const auto coding = _toLower(_trim(item.substr(0, semicolon)));
+        if (coding.empty())
+            continue;
+        double quality = 1.0;
+        if (semicolon != std::string::npos)
+        {
+            const auto parameter = _trim(item.substr(semicolon + 1));
+            if (parameter.compare(0, 2, "q=") == 0)
+                quality = std::strtod(parameter.c_str() + 2, nullptr);
+        }
+        codings[coding] = quality;
+    }
+    return codings;
+}
+
+Encoding _negotiate(const std::map<Header, std::string>& headers)
+{
+    const auto header = headers.find(Header::ACCEPT_ENCODING);
+    if (header == headers.end())
+        return Encoding::identity;
+
+    const auto codings = _parseAcceptEncoding(header->second);
+    const auto getQuality = [&codings](const std::string& coding) {
+        auto it = codings.find(coding);
+        if (it == codings.end())
+            it = codings.find("*");
+        return it != codings.end() ? it->second : 0.0;
+    };
+    const auto gzip = getQuality("gzip");
+    const auto deflate = getQuality("deflate");
+    if (gzip > 0.0 && gzip >= deflate)
+        return Encoding::gzip;
+    if (deflate > 0.0)
+        return Encoding::deflate;
+    return Encoding::identity;
+}
+
+// Media types which are usually already compressed are not worth the CPU
+bool _isCompressible(const Response& response)
+{
+    const auto header = response.headers.find(Header::CONTENT_TYPE);
+    if (header == response.headers.end())
+        return true;
+    const auto type = _toLower(header->second);
+    return type.compare(0, 5, "text/") == 0 ||
+           type.find("json") != std::string::npos ||
+           type.find("javascript") != std::string::npos ||
+           type.find("xml") != std::string::npos ||
+           type.find("wasm") != std::string::npos;
+}
+
+void _addVary(Response& response)
+{
+    auto& vary = response.headers[Header::VARY];
+    if (_toLower(vary).find(_toLower(ACCEPT_ENCODING)) != std::string::npos)
+        return;
+    vary.append(vary.empty() ? ACCEPT_ENCODING : ", " + ACCEPT_ENCODING);
+}
+
+// gzip has a header and trailer around the deflate stream, "deflate" in HTTP
+// means the zlib format, not a raw deflate stream (RFC 7230 4.2.2)
+std::string _deflate(const std::string& data, const Encoding encoding,
+                     const int level)
+{
+    z_stream stream{};
+    const int windowBits = encoding == Encoding::gzip ? 15 + 16 : 15;
+    if (deflateInit2(&stream, level, Z_DEFLATED, windowBits, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        throw std::runtime_error("deflateInit2 failed");
+    }
+
+    std::string output(deflateBound(&stream, data.size()), '\0');
+    stream.next_in = (Bytef*)data.data();
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = (Bytef*)&output[0];
+    stream.avail_out = static_cast<uInt>(output.size());
+    const auto result = deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    if (result != Z_STREAM_END)
+        throw std::runtime_error("deflate failed");
+    return output;
+}
+} // anonymous namespace
+
+Compressor::Compressor(const Compression& options)
+    : _options(options)
+{
+    if (_options.enabled && (_options.level < 1 || _options.level > 9))
+        throw std::invalid_argument("Invalid HTTP compression level");
+}
+
+Compressor::~Compressor()
+{
+}
+
+void Compressor::compress(const Request& request, Response& response)
+{
+    if (response.producer || response.body.size() < _options.minSize ||
+        response.body.size() > std::numeric_limits<uInt>::max() ||
+        response.headers.count(Header::CONTENT_ENCODING) ||
+        !_isCompressible(response))
+    {
+        return;
+    }
+    _addVary(response);
+
+    const auto encoding = _negotiate(request.headers);
+    if (encoding == Encoding::identity)
+        return;
+
+    // responses to other methods are not expected to be repeated
+    const bool cached = request.method == Method::GET;
+    const auto coding = to_string(encoding);
+    const auto key = cached ? std::hash<std::string>()(response.body) : 0;
+    std::string compressed;
+    if (!cached || !_find(key, coding, response.body, compressed))
+    {
+        compressed = _deflate(response.body, encoding, _options.level);
+        if (compressed.size() >= response.body.size())
+            compressed.clear(); // remembered as not worth it
+        if (cached)
+            _insert(key, coding, response.body, compressed);
+    }
+    if (compressed.empty())
+        return;
+
+    response.body = std::move(compressed);
+    response.headers[Header::CONTENT_ENCODING] = coding;
+
+    // the original representation keeps the strong validator (RFC 7232 2.1)
+    const auto etag = response.headers.find(Header::ETAG);
+    if (etag != response.headers.end() && etag->second.compare(0, 2, "W/"))
+        etag->second.insert(0, "W/");
+}
+
+bool Compressor::_find(const size_t key, const std::string& encoding,
+                       const std::string& body, std::string& compressed)
+{
+    std::lock_guard<std::mutex> lock{_mutex};
+    const auto range = _index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const auto entry = it->second;
+        if (entry->encoding != encoding || entry->body != body)
+            continue;
+        _entries.splice(_entries.begin(), _entries, entry);
+        compressed = entry->compressed;
+        return true;
+    }
+    return false;
+}
+
+void Compressor::_insert(const size_t key, const std::string& encoding,
+                         const std::string& body,
+                         const std::string& compressed)
+{
+    const auto size = body.size() + compressed.size();
+    if (size > _options.cacheSize)
+        return;
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    const auto range = _index.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        const auto entry = it->second;
+        if (entry->encoding == encoding && entry->body == body)
+            return; // compressed concurrently
+    }
+    while (_cachedSize + size > _options.cacheSize)
+    {
+        const auto last = std::prev(_entries.end());
+        const auto range = _index.equal_range(last->key);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == last)
+            {
+                _index.erase(it);
+                break;
+            }
+        }
+        _cachedSize -= last->body.size() + last->compressed.size();
+        _entries.erase(last);
+    }
+    _entries.push_front({key, encoding, body, compressed});
+    _index.emplace(key, _entries.begin());
+    _cachedSize += size;
+}
+}
+}
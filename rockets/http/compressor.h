@@ -0,0 +1,82 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_HTTP_COMPRESSOR_H
+#define ROCKETS_HTTP_COMPRESSOR_H
+
+#include <rockets/http/request.h>
+#include <rockets/http/response.h>
+#include <rockets/http/types.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace rockets
+{
+namespace http
+{
+/**
+ * Compress the body of responses with the encoding negotiated from the
+ * Accept-Encoding header of their request, gzip being preferred to deflate.
+ *
+ * Compressible responses get a "Vary: Accept-Encoding" header whether they are
+ * compressed or not, so that shared caches keep both forms apart. Bodies which
+ * would not get smaller are sent as they are.
+ *
+ * The compressed bodies of GET responses are cached by encoding and content,
+ * along with the original body which must be identical for a cache hit, so
+ * that responses which do not change are only compressed once.
+ *
+ * Thread safe.
+ */
+class Compressor
+{
+public:
+    explicit Compressor(const Compression& options);
+    ~Compressor();
+
+    /** Compress the body of the response to the request, if applicable. */
+    void compress(const Request& request, Response& response);
+
+private:
+    struct Entry
+    {
+        size_t key; // hash of the body
+        std::string encoding;
+        std::string body;
+        std::string compressed;
+    };
+    using Entries = std::list<Entry>;
+
+    const Compression _options;
+    std::mutex _mutex;
+    size_t _cachedSize = 0;
+    Entries _entries; // most recently used first
+    std::unordered_multimap<size_t, Entries::iterator> _index;
+
+    bool _find(size_t key, const std::string& encoding,
+               const std::string& body, std::string& compressed);
+    void _insert(size_t key, const std::string& encoding,
+                 const std::string& body, const std::string& compressed);
+};
+}
+}
+
+#endif
@@ -22,8 +22,15 @@
 #include "../helpers.h"
 #include "utils.h"
 
+#include <algorithm>
+
 namespace
 {
+const size_t chunkSize = 16 * 1024;
+const std::chrono::microseconds minPollDelay{1000};
+// polling is the only way to learn about futures, keep their latency low
+const std::chrono::microseconds maxPollDelay{4000};
+
 const std::logic_error response_already_set_error{"response was already set!"};
 const std::logic_error headers_already_sent_error{
     "response headers were already sent!"};
@@ -42,12 +49,12 @@ Connection::Connection(lws* wsi, const char* path)
     : channel{wsi}
     , request{channel.readMethod(),          path,
               channel.readOrigin(),          channel.readHost(),
-              channel.readQueryParameters(), ""}
+              channel.readQueryParameters(), "",
+              {},                            channel.readRequestHeaders()}
     , contentLength{channel.readContentLength()}
     , corsHeaders(channel.readCorsRequestHeaders())
     , corsResponseHeaders(_getCorsResponseHeaders())
 {
-    request.body.reserve(contentLength);
 }
 
 std::string Connection::getPathWithoutLeadingSlash() const
@@ -66,11 +73,37 @@ bool Connection::canHaveHttpBody() const
     return _canHaveHttpBody(getMethod()) && contentLength > 0;
 }
 
+size_t Connection::getContentLength() const
+{
+    return contentLength;
+}
+
+size_t Connection::getBodySize() const
+{
+    return request.body.size();
+}
+
 void Connection::appendBody(const char* in, const size_t len)
 {
+    if (bodyDiscarded)
+        return;
+    // reserved on the first chunk, once the size was accepted
+    if (request.body.empty())
+        request.body.reserve(contentLength);
     request.body.append(in, len);
 }
 
+void Connection::discardBody()
+{
+    bodyDiscarded = true;
+    std::string().swap(request.body);
+}
+
+bool Connection::isBodyDiscarded() const
+{
+    return bodyDiscarded;
+}
+
 bool Connection::isCorsPreflightRequest() const
 {
     return getMethod() == Method::OPTIONS && _hasCorsPreflightHeaders();
@@ -81,6 +114,11 @@ void Connection::overwriteRequestPath(std::string path)
     request.path = std::move(path);
 }
 
+void Connection::setRequestParams(std::map<std::string, std::string> params)
+{
+    request.params = std::move(params);
+}
+
 void Connection::setResponse(std::future<Response>&& futureResponse)
 {
     if (isResponseSet())
@@ -109,11 +147,43 @@ bool Connection::isResponseReady() const
     return responseFinalized || is_ready(delayedResponse);
 }
 
+void Connection::setResponseNotified()
+{
+    responseNotified = true;
+}
+
+bool Connection::isResponseNotified() const
+{
+    return responseNotified;
+}
+
 void Connection::requestWriteCallback()
 {
     channel.requestCallback();
 }
 
+void Connection::requestDelayedWriteCallback()
+{
+    pollDelay = std::min(std::max(pollDelay * 2, minPollDelay), maxPollDelay);
+    channel.requestDelayedCallback(pollDelay);
+}
+
+void Connection::setReceiveEnabled(const bool enabled)
+{
+    channel.setReceiveEnabled(enabled);
+}
+
+void Connection::compressResponse(Compressor& compressor)
+{
+    if (responseHeadersSent)
+        throw headers_already_sent_error;
+
+    if (!responseFinalized)
+        _finalizeResponse();
+
+    compressor.compress(request, response);
+}
+
 int Connection::writeResponseHeaders()
 {
     if (responseHeadersSent)
@@ -138,6 +208,8 @@ int Connection::writeResponseBody()
 #else
         return 0;
 #endif
+    if (response.producer)
+        return _writeResponseChunk();
     if (response.body.empty())
         throw body_empty_error;
 
@@ -182,5 +254,45 @@ void Connection::_finalizeResponse()
     }
     responseFinalized = true;
 }
+
+int Connection::_writeResponseChunk()
+{
+    if (chunk.empty())
+        chunk.resize(Channel::chunkPrefixSize + chunkSize +
+                     Channel::chunkSuffixSize);
+    auto data = chunk.data() + Channel::chunkPrefixSize;
+
+    // a known size is sent as is, up to the last byte announced
+    const auto total = response.producerSize;
+    const auto maxSize = total > 0
+                             ? std::min(chunkSize, total - responseBodyWritten)
+                             : chunkSize;
+
+    size_t size = 0;
+    try
+    {
+        size = response.producer(reinterpret_cast<char*>(data), maxSize);
+    }
+    catch (...)
+    {
+        // the status was already sent, the client can only learn about the
+        // failure from a body that ends before it is complete
+        return -1;
+    }
+    size = std::min(size, maxSize);
+    if (total > 0 && size == 0)
+        return -1; // shorter than announced
+    responseBodyWritten += size;
+
+    const bool last = total > 0 ? responseBodyWritten == total : size == 0;
+    const auto ret = total > 0 ? channel.writeResponseData(data, size, last)
+                               : channel.writeResponseChunk(data, size);
+    if (last)
+    {
+        responseBodySent = true;
+        std::vector<unsigned char>().swap(chunk);
+    }
+    return ret;
+}
 } // namespace http
 } // namespace rockets
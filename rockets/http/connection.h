@@ -21,12 +21,15 @@
 #define ROCKETS_HTTP_CONNECTION_H
 
 #include <rockets/http/channel.h>
+#include <rockets/http/compressor.h>
 #include <rockets/http/cors.h>
 #include <rockets/http/request.h>
 #include <rockets/http/types.h>
 
 #include <libwebsockets.h>
 
+#include <vector>
+
 namespace rockets
 {
 namespace http
@@ -39,18 +42,25 @@ class Connection
 public:
     Connection(lws* wsi, const char* path);
 
+    lws* getWsi() const { return channel.getWsi(); }
+
     // request
 
     std::string getPathWithoutLeadingSlash() const;
     Method getMethod() const;
 
     bool canHaveHttpBody() const;
+    size_t getContentLength() const;
+    size_t getBodySize() const;
     void appendBody(const char* in, const size_t len);
+    void discardBody();
+    bool isBodyDiscarded() const;
 
     bool isCorsPreflightRequest() const;
 
     const Request& getRequest() const { return request; }
     void overwriteRequestPath(std::string path);
+    void setRequestParams(std::map<std::string, std::string> params);
 
     // response
 
@@ -60,8 +70,16 @@ public:
     bool isResponseSet() const;
     bool isResponseReady() const;
 
+    /** Announce that the service thread is woken up once it is ready. */
+    void setResponseNotified();
+    bool isResponseNotified() const;
+
     void requestWriteCallback();
+    /** Book a write callback after a delay growing up to 4 ms on each call. */
+    void requestDelayedWriteCallback();
+    void setReceiveEnabled(bool enabled);
 
+    void compressResponse(Compressor& compressor);
     int writeResponseHeaders();
     int writeResponseBody();
 
@@ -71,21 +89,27 @@ private:
     Channel channel;
     Request request;
     size_t contentLength = 0;
+    bool bodyDiscarded = false;
     CorsRequestHeaders corsHeaders;
 
     CorsResponseHeaders corsResponseHeaders;
     std::future<Response> delayedResponse;
     bool delayedResponseSet = false;
     bool responseFinalized = false;
+    bool responseNotified = false;
+    std::chrono::microseconds pollDelay{0};
     Response response;
 
     bool responseHeadersSent = false;
     bool responseBodySent = false;
+    size_t responseBodyWritten = 0;
+    std::vector<unsigned char> chunk;
 
     bool _canHaveHttpBody(Method m) const;
     bool _hasCorsPreflightHeaders() const;
     CorsResponseHeaders _getCorsResponseHeaders() const;
     void _finalizeResponse();
+    int _writeResponseChunk();
 };
 }
 }
@@ -23,30 +23,70 @@
 #include "request.h"
 #include "response.h"
 
+#include <atomic>
+
 namespace
 {
 const std::string JSON_TYPE = "application/json";
 const std::string REQUEST_REGISTRY = "registry";
 
 const int codeContinue = 0;
-
-std::string _removeEndpointFromPath(const std::string& endpoint,
-                                    const std::string& path)
-{
-    if (endpoint == "/")
-        return path;
-
-    if (endpoint.size() >= path.size())
-        return std::string();
-
-    return path.substr(endpoint.size());
-}
 } // anonymous namespace
 
 namespace rockets
 {
 namespace http
 {
+namespace
+{
+/**
+ * Set the delayed response of a connection once, then notify its service
+ * thread. An abandoned response is set to 500 "Internal Server Error".
+ */
+class ResponseSink
+{
+public:
+    explicit ResponseSink(std::function<void()> notify)
+        : _state{std::make_shared<State>(std::move(notify))}
+    {
+    }
+
+    std::future<Response> getFuture() { return _state->promise.get_future(); }
+    void operator()(Response response) const
+    {
+        _state->set(std::move(response));
+    }
+
+private:
+    struct State
+    {
+        std::promise<Response> promise;
+        std::atomic_bool done{false};
+        std::function<void()> notify;
+
+        explicit State(std::function<void()> notify_)
+            : notify{std::move(notify_)}
+        {
+        }
+        ~State()
+        {
+            if (!done)
+                set(Response{Code::INTERNAL_SERVER_ERROR});
+        }
+
+        void set(Response response)
+        {
+            if (done.exchange(true))
+                return;
+            promise.set_value(std::move(response));
+            if (notify)
+                notify();
+        }
+    };
+    std::shared_ptr<State> _state;
+};
+} // anonymous namespace
+
 ConnectionHandler::ConnectionHandler(const Registry& registry)
     : _registry(registry)
 {
@@ -57,8 +97,32 @@ void ConnectionHandler::setFilter(const Filter* filter)
     _filter = filter;
 }
 
+void ConnectionHandler::setNotifier(Notifier notifier)
+{
+    _notifier = std::move(notifier);
+}
+
+void ConnectionHandler::setExecutor(Executor executor, Response rejectResponse)
+{
+    _executor = std::move(executor);
+    _rejectResponse = std::move(rejectResponse);
+}
+
+void ConnectionHandler::setCompressor(Compressor* compressor)
+{
+    _compressor = compressor;
+}
+
+void ConnectionHandler::setMaxBodySize(const size_t size)
+{
+    _maxBodySize = size;
+}
+
 void ConnectionHandler::handleNewRequest(Connection& connection) const
 {
+    if (_maxBodySize > 0 && connection.getContentLength() > _maxBodySize)
+        connection.discardBody();
+
     if (connection.isCorsPreflightRequest())
         _prepareCorsPreflightResponse(connection);
     else if (!connection.canHaveHttpBody())
@@ -68,6 +132,9 @@ void ConnectionHandler::handleNewRequest(Connection& connection) const
 void ConnectionHandler::handleData(Connection& connection, const char* data,
                                    const size_t size) const
 {
+    // also covers chunked requests without Content-Length
+    if (_maxBodySize > 0 && connection.getBodySize() + size > _maxBodySize)
+        connection.discardBody();
     connection.appendBody(data, size);
 }
 
@@ -80,6 +147,12 @@ void ConnectionHandler::prepareResponse(Connection& connection) const
     if (!connection.canHaveHttpBody() && connection.isResponseSet())
         return;
 #endif
+    if (connection.isBodyDiscarded())
+    {
+        connection.setResponse(make_ready_response(Code::PAYLOAD_TOO_LARGE));
+        connection.requestWriteCallback();
+        return;
+    }
     connection.setResponse(_generateResponse(connection));
     connection.requestWriteCallback();
 }
@@ -91,13 +164,18 @@ int ConnectionHandler::writeResponse(Connection& connection) const
 
     if (!connection.isResponseReady())
     {
-        // Keep polling until response is ready
-        connection.requestWriteCallback();
+        // Notified responses book the write callback once they are ready
+        if (!connection.isResponseNotified())
+            connection.requestDelayedWriteCallback();
         return codeContinue;
     }
 
     if (!connection.wereResponseHeadersSent())
+    {
+        if (_compressor)
+            connection.compressResponse(*_compressor);
         return connection.writeResponseHeaders();
+    }
 
     return connection.writeResponseBody();
 }
@@ -114,16 +192,12 @@ std::future<Response> ConnectionHandler::_generateResponse(
     if (connection.getMethod() == Method::GET && path == REQUEST_REGISTRY)
         return make_ready_response(Code::OK, _registry.toJson(), JSON_TYPE);
 
-    const auto result = _registry.findEndpoint(connection.getMethod(), path);
+    auto result = _registry.findEndpoint(connection.getMethod(), path);
     if (result.found)
     {
-        const auto& endpoint = result.endpoint;
-        const auto pathStripped = _removeEndpointFromPath(endpoint, path);
-        if (pathStripped.empty() || *endpoint.rbegin() == '/')
-        {
-            connection.overwriteRequestPath(pathStripped);
-            return _callHandler(connection, endpoint);
-        }
+        connection.overwriteRequestPath(std::move(result.path));
+        connection.setRequestParams(std::move(result.params));
+        return _callHandler(connection, result.endpoint);
     }
 
     // return informative error 405 "Method Not Allowed" if possible
@@ -139,10 +213,49 @@ std::future<Response> ConnectionHandler::_generateResponse(
 }
 
 std::future<Response> ConnectionHandler::_callHandler(
-    const Connection& connection, const std::string& endpoint) const
+    Connection& connection, const std::string& endpoint) const
 {
-    const auto& func = _registry.getFunction(connection.getMethod(), endpoint);
-    return func(connection.getRequest());
+    const auto function =
+        _registry.getFunction(connection.getMethod(), endpoint);
+    if (!_executor && function.func)
+        return function.func(connection.getRequest());
+
+    ResponseSink sink{_notifier ? _notifier(connection) : nullptr};
+    auto future = sink.getFuture();
+    if (_notifier)
+        connection.setResponseNotified();
+
+    if (!_executor)
+    {
+        try
+        {
+            function.funcAsync(connection.getRequest(), sink);
+        }
+        catch (...)
+        {
+            sink(Response{Code::INTERNAL_SERVER_ERROR});
+        }
+        return future;
+    }
+
+    // The task owns copies of the handler and request, the connection may be
+    // closed and the endpoint removed before it runs.
+    auto task = [function, request = connection.getRequest(), sink] {
+        try
+        {
+            if (function.funcAsync)
+                function.funcAsync(request, sink);
+            else
+                sink(function.func(request).get());
+        }
+        catch (...)
+        {
+            sink(Response{Code::INTERNAL_SERVER_ERROR});
+        }
+    };
+    if (!_executor(connection, std::move(task)))
+        return make_ready_response(_rejectResponse);
+    return future;
 }
 
 void ConnectionHandler::_prepareCorsPreflightResponse(
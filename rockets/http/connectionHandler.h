@@ -25,6 +25,8 @@
 #include <rockets/http/registry.h>
 #include <rockets/http/types.h>
 
+#include <functional>
+
 namespace rockets
 {
 namespace http
@@ -43,9 +45,54 @@ namespace http
 class ConnectionHandler
 {
 public:
+    /**
+     * Run the handler of a request outside of the calling service thread.
+     *
+     * @return false if the request is rejected.
+     */
+    using Executor =
+        std::function<bool(Connection& connection, std::function<void()>)>;
+
+    /**
+     * Make the function waking up the service thread of a connection once its
+     * delayed response is ready, which may be called from any thread.
+     */
+    using Notifier = std::function<std::function<void()>(Connection&)>;
+
     ConnectionHandler(const Registry& registry);
     void setFilter(const Filter* filter);
 
+    /**
+     * Set the notifier for delayed responses.
+     *
+     * Without notifier, the delayed responses are polled with a growing delay.
+     * Responses which are futures returned by the handlers are always polled
+     * without executor, since nothing signals their completion.
+     */
+    void setNotifier(Notifier notifier);
+
+    /**
+     * Set the executor for the registered handlers.
+     *
+     * @param executor to set, nullptr to call the handlers directly.
+     * @param rejectResponse the response to requests refused by the executor.
+     */
+    void setExecutor(Executor executor, Response rejectResponse);
+
+    /**
+     * Set the compressor of the response bodies.
+     *
+     * @param compressor to set, nullptr to send the bodies uncompressed.
+     */
+    void setCompressor(Compressor* compressor);
+
+    /**
+     * Set the maximum size of request bodies, 0 for unlimited. The body of
+     * larger requests is discarded while it is received, then answered with
+     * 413 "Payload Too Large".
+     */
+    void setMaxBodySize(size_t size);
+
     void handleNewRequest(Connection& connection) const;
     void handleData(Connection& connection, const char* data,
                     size_t size) const;
@@ -54,11 +101,16 @@ public:
 
 private:
     const http::Filter* _filter = nullptr;
+    Compressor* _compressor = nullptr;
     const Registry& _registry;
+    Executor _executor;
+    Notifier _notifier;
+    Response _rejectResponse;
+    size_t _maxBodySize = 0;
 
     void _prepareCorsPreflightResponse(Connection& connection) const;
     std::future<Response> _generateResponse(Connection& connection) const;
-    std::future<Response> _callHandler(const Connection& connection,
+    std::future<Response> _callHandler(Connection& connection,
                                        const std::string& endpoint) const;
     CorsResponseHeaders _makeCorsPreflighResponseHeaders(
         const std::string& path) const;
@@ -0,0 +1,373 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "fileServer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <iomanip>
+#include <locale>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <fstream>
+#ifndef S_ISREG
+#define S_ISREG(mode) (((mode)&S_IFMT) == S_IFREG)
+#endif
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace rockets
+{
+namespace http
+{
+namespace
+{
+const std::string INDEX_FILE = "index.html";
+const size_t MAX_CACHED_FILE_SIZE = 1024 * 1024;
+const std::string DEFAULT_TYPE = "application/octet-stream";
+const char* const HTTP_DATE_FORMAT = "%a, %d %b %Y %H:%M:%S GMT";
+
+const std::map<std::string, std::string> contentTypes{
+    {"css", "text/css"},
+    {"csv", "text/csv"},
+    {"gif", "image/gif"},
+    {"glb", "model/gltf-binary"},
+    {"gltf", "model/gltf+json"},
+    {"htm", "text/html"},
+    {"html", "text/html"},
+    {"ico", "image/x-icon"},
+    {"jpeg", "image/jpeg"},
+    {"jpg", "image/jpeg"},
+    {"js", "application/javascript"},
+    {"json", "application/json"},
+    {"map", "application/json"},
+    {"mjs", "application/javascript"},
+    {"mp4", "video/mp4"},
+    {"otf", "font/otf"},
+    {"pdf", "application/pdf"},
+    {"png", "image/png"},
+    {"svg", "image/svg+xml"},
+    {"ttf", "font/ttf"},
+    {"txt", "text/plain"},
+    {"wasm", "application/wasm"},
+    {"webm", "video/webm"},
+    {"webp", "image/webp"},
+    {"woff", "font/woff"},
+    {"woff2", "font/woff2"},
+    {"xml", "application/xml"}};
+
+std::string _getContentType(const std::string& path)
+{
+    const auto dot = path.rfind('.');
+    if (dot == std::string::npos || path.find('/', dot) != std::string::npos)
+        return DEFAULT_TYPE;
+    auto extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   ::tolower);
+    const auto it = contentTypes.find(extension);
+    return it != contentTypes.end() ? it->second : DEFAULT_TYPE;
+}
+
+// @return the absolute path without symbolic links, or "" if it is not found
+std::string _getRealPath(const std::string& path)
+{
+#ifdef _WIN32
+    char* resolved = _fullpath(nullptr, path.c_str(), 0);
+#else
+    char* resolved = realpath(path.c_str(), nullptr);
+#endif
+    if (!resolved)
+        return std::string();
+    std::string result{resolved};
+    free(resolved);
+    return result;
+}
+
+bool _isInside(const std::string& root, const std::string& path)
+{
+    if (path.compare(0, root.size(), root) != 0)
+        return false;
+    return path.size() == root.size() || root.back() == '/' ||
+           path[root.size()] == '/' || path[root.size()] == '\\';
+}
+
+std::string _makeETag(const size_t size, const time_t modified)
+{
+    std::ostringstream etag;
+    etag << '"' << std::hex << modified << '-' << size << '"';
+    return etag.str();
+}
+
+std::string _formatHttpDate(const time_t time)
+{
+    tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &time);
+#else
+    gmtime_r(&time, &utc);
+#endif
+    char buffer[64];
+    const auto size = strftime(buffer, sizeof(buffer), HTTP_DATE_FORMAT, &utc);
+    return std::string(buffer, size);
+}
+
+// @return the time of an IMF-fixdate, the format of Last-Modified, or -1
+time_t _parseHttpDate(const std::string& date)
+{
+    tm utc{};
+    std::istringstream stream{date};
+    stream.imbue(std::locale::classic());
+    stream >> std::get_time(&utc, HTTP_DATE_FORMAT);
+    if (stream.fail())
+        return -1;
+#ifdef _WIN32
+    return _mkgmtime(&utc);
+#else
+    return timegm(&utc);
+#endif
+}
+
+// If-None-Match is a list of entity tags, compared weakly (RFC 7232 3.2)
+bool _matchesETag(const std::string& list, const std::string& etag)
+{
+    std::istringstream stream{list};
+    std::string tag;
+    while (std::getline(stream, tag, ','))
+    {
+        const auto begin = tag.find_first_not_of(" \t");
+        const auto end = tag.find_last_not_of(" \t");
+        if (begin == std::string::npos)
+            continue;
+        tag = tag.substr(begin, end - begin + 1);
+        if (tag.compare(0, 2, "W/") == 0)
+            tag = tag.substr(2);
+        if (tag == "*" || tag == etag)
+            return true;
+    }
+    return false;
+}
+
+// If-Modified-Since only applies without If-None-Match (RFC 7232 3.3)
+bool _isNotModified(const std::map<Header, std::string>& headers,
+                    const std::string& etag, const time_t modified)
+{
+    const auto noneMatch = headers.find(Header::IF_NONE_MATCH);
+    if (noneMatch != headers.end())
+        return _matchesETag(noneMatch->second, etag);
+
+    const auto modifiedSince = headers.find(Header::IF_MODIFIED_SINCE);
+    if (modifiedSince == headers.end())
+        return false;
+    const auto since = _parseHttpDate(modifiedSince->second);
+    return since != -1 && modified <= since;
+}
+} // anonymous namespace
+
+/**
+ * A file open for reading until destruction.
+ */
+class FileServer::File
+{
+public:
+    explicit File(const std::string& path)
+#ifdef _WIN32
+        : _stream{path, std::ios::binary}
+    {
+        if (!_stream)
+            throw std::runtime_error("Could not open file: " + path);
+    }
+#else
+        : _fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)}
+    {
+        if (_fd < 0)
+            throw std::runtime_error("Could not open file: " + path);
+    }
+#endif
+
+    ~File()
+    {
+#ifndef _WIN32
+        ::close(_fd);
+#endif
+    }
+
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    /** @return the number of bytes read, 0 at the end of the file or on error */
+    size_t read(char* data, const size_t size, const size_t offset)
+    {
+#ifdef _WIN32
+        _stream.clear();
+        if (!_stream.seekg(offset))
+            return 0;
+        _stream.read(data, size);
+        return size_t(_stream.gcount());
+#else
+        ssize_t count;
+        do
+            count = ::pread(_fd, data, size, off_t(offset));
+        while (count < 0 && errno == EINTR);
+        return count > 0 ? size_t(count) : 0;
+#endif
+    }
+
+private:
+#ifdef _WIN32
+    std::ifstream _stream;
+#else
+    const int _fd;
+#endif
+};
+
+FileServer::FileServer(const size_t cacheSize)
+    : _cacheSize{cacheSize}
+{
+}
+
+FileServer::~FileServer()
+{
+}
+
+Response FileServer::serve(const std::string& directory,
+                           const Request& request)
+{
+    auto path = request.path;
+    if (path.empty() || path.back() == '/')
+        path.append(INDEX_FILE);
+
+    // lws already removed the "..", but symbolic links may lead anywhere
+    const auto root = _getRealPath(directory);
+    const auto filename = _getRealPath(directory + '/' + path);
+    if (root.empty() || filename.empty() || !_isInside(root, filename))
+        return Response{Code::NOT_FOUND};
+
+    struct stat info;
+    if (::stat(filename.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+        return Response{Code::NOT_FOUND};
+    const auto size = size_t(info.st_size);
+    const auto modified = info.st_mtime;
+
+    Response response{Code::OK};
+    const auto etag = _makeETag(size, modified);
+    response.headers[Header::ETAG] = etag;
+    response.headers[Header::LAST_MODIFIED] = _formatHttpDate(modified);
+    if (_isNotModified(request.headers, etag, modified))
+    {
+        response.code = Code::NOT_MODIFIED;
+        return response;
+    }
+
+    response.headers[Header::CONTENT_TYPE] = _getContentType(path);
+    if (size == 0)
+        return response;
+
+    std::shared_ptr<File> file;
+    try
+    {
+        // a body, unlike a producer, can be compressed
+        if (const auto contents = _load(filename, size, modified))
+        {
+            response.body = *contents;
+            return response;
+        }
+        file = std::make_shared<File>(filename);
+    }
+    catch (const std::runtime_error&)
+    {
+        return Response{Code::FORBIDDEN};
+    }
+
+    // a file truncated meanwhile ends the response before its announced size
+    response.producerSize = size;
+    response.producer = [file, size, offset = size_t(0)](
+        char* data, const size_t maxSize) mutable {
+        const auto count = file->read(data, std::min(maxSize, size - offset),
+                                      offset);
+        offset += count;
+        return count;
+    };
+    return response;
+}
+
+FileServer::ContentsPtr FileServer::_load(const std::string& path,
+                                          const size_t size,
+                                          const time_t modified)
+{
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        const auto it = _index.find(path);
+        if (it != _index.end())
+        {
+            const auto entry = it->second;
+            if (entry->size == size && entry->modified == modified)
+            {
+                _entries.splice(_entries.begin(), _entries, entry);
+                return entry->contents;
+            }
+            _cachedSize -= entry->size;
+            _entries.erase(entry);
+            _index.erase(it);
+        }
+    }
+    if (size > std::min(_cacheSize, MAX_CACHED_FILE_SIZE))
+        return nullptr;
+
+    // read outside of the lock, other files can be served meanwhile
+    auto buffer = std::string(size, '\0');
+    File file{path};
+    size_t offset = 0;
+    while (offset < size)
+    {
+        const auto count = file.read(&buffer[offset], size - offset, offset);
+        if (count == 0)
+            throw std::runtime_error("Could not read file: " + path);
+        offset += count;
+    }
+    auto contents = std::make_shared<const std::string>(std::move(buffer));
+
+    std::lock_guard<std::mutex> lock{_mutex};
+    if (_index.count(path)) // read concurrently by another thread
+        return contents;
+    _evict(_cacheSize - size);
+    _entries.push_front({path, size, modified, contents});
+    _index.emplace(path, _entries.begin());
+    _cachedSize += size;
+    return contents;
+}
+
+void FileServer::_evict(const size_t maxSize)
+{
+    while (_cachedSize > maxSize)
+    {
+        const auto& entry = _entries.back();
+        _cachedSize -= entry.size;
+        _index.erase(entry.path);
+        _entries.pop_back();
+    }
+}
+}
+}
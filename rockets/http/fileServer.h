@@ -0,0 +1,94 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_HTTP_FILESERVER_H
+#define ROCKETS_HTTP_FILESERVER_H
+
+#include <rockets/http/request.h>
+#include <rockets/http/response.h>
+
+#include <ctime>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace rockets
+{
+namespace http
+{
+/**
+ * Serve the files of directories in answer to GET requests.
+ *
+ * Files are read in parts as the response is sent, with a Content-Type guessed
+ * from their extension. Their ETag and Last-Modified headers derive from their
+ * size and modification time, so conditional requests are answered with 304
+ * "Not Modified" from the file metadata alone. Paths resolving outside of the
+ * directory, including through symbolic links, are not served.
+ *
+ * The contents of small files are kept in a cache up to a maximum total size,
+ * evicting the least recently used files first. Cached files are checked
+ * against the metadata on each request, modified files are read again. They
+ * are answered with a body, which can be compressed, instead of in parts.
+ *
+ * Thread safe.
+ */
+class FileServer
+{
+public:
+    /** @param cacheSize the maximum size of the cached files, 0 for none. */
+    explicit FileServer(size_t cacheSize);
+    ~FileServer();
+
+    /**
+     * Answer a request for a file of a directory.
+     *
+     * @param directory the root of the files to serve.
+     * @param request whose path is the path of the file in the directory,
+     *        "index.html" of the directory if it is empty or ends with '/'.
+     * @return the Response with the file, or an error code.
+     */
+    Response serve(const std::string& directory, const Request& request);
+
+private:
+    class File;
+    using ContentsPtr = std::shared_ptr<const std::string>;
+
+    struct Entry
+    {
+        std::string path;
+        size_t size;
+        time_t modified;
+        ContentsPtr contents;
+    };
+    using Entries = std::list<Entry>;
+
+    const size_t _cacheSize;
+    std::mutex _mutex;
+    size_t _cachedSize = 0;
+    Entries _entries; // most recently used first
+    std::unordered_map<std::string, Entries::iterator> _index;
+
+    ContentsPtr _load(const std::string& path, size_t size, time_t modified);
+    void _evict(size_t maxSize);
+};
+}
+}
+
+#endif
@@ -22,85 +22,306 @@
 #include "registry.h"
 
 #include "../json.hpp"
+#include "request.h"
+#include "response.h"
 
-#include <algorithm>
+#include <stdexcept>
 
 namespace rockets
 {
 namespace http
 {
+namespace
+{
+const std::array<const char*, size_t(Method::ALL)> methodNames{
+    {"GET", "POST", "PUT", "PATCH", "DELETE", "OPTIONS"}};
+
+/** A part of an endpoint: fixed text, or the name of a parameter. */
+struct Token
+{
+    std::string text;
+    bool param;
+};
+
+std::vector<Token> _tokenize(const std::string& endpoint)
+{
+    std::vector<Token> tokens;
+    size_t pos = 0;
+    while (pos < endpoint.size())
+    {
+        const auto open = endpoint.find('{', pos);
+        if (open == std::string::npos)
+        {
+            tokens.push_back({endpoint.substr(pos), false});
+            break;
+        }
+        const auto close = endpoint.find('}', open);
+        if (close == std::string::npos || close == open + 1 ||
+            (open > 0 && endpoint[open - 1] != '/') ||
+            (close + 1 < endpoint.size() && endpoint[close + 1] != '/'))
+        {
+            throw std::invalid_argument("Invalid parameter in endpoint: " +
+                                        endpoint);
+        }
+        if (open > pos)
+            tokens.push_back({endpoint.substr(pos, open - pos), false});
+        tokens.push_back({endpoint.substr(open + 1, close - open - 1), true});
+        pos = close + 1;
+    }
+    return tokens;
+}
+
+size_t _commonLength(const std::string& prefix, const std::string& text,
+                     const size_t pos)
+{
+    size_t i = 0;
+    while (i < prefix.size() && pos + i < text.size() &&
+           prefix[i] == text[pos + i])
+    {
+        ++i;
+    }
+    return i;
+}
+}
+
+struct Registry::Node
+{
+    std::string prefix; // text of the edge from the parent, or param name
+    std::vector<std::unique_ptr<Node>> children; // with distinct first chars
+    std::unique_ptr<Node> param;                 // matching one path segment
+    const Routes::value_type* route = nullptr;   // if an endpoint ends here
+
+    const Node* findChild(const char c) const
+    {
+        for (const auto& child : children)
+        {
+            if (child->prefix[0] == c)
+                return child.get();
+        }
+        return nullptr;
+    }
+
+    // Add the nodes for text, splitting the edges which only partially match
+    Node* insert(const std::string& text)
+    {
+        Node* node = this;
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            auto it = node->children.begin();
+            while (it != node->children.end() && (*it)->prefix[0] != text[pos])
+                ++it;
+            if (it == node->children.end())
+            {
+                node->children.emplace_back(new Node);
+                node->children.back()->prefix = text.substr(pos);
+                return node->children.back().get();
+            }
+
+            auto& child = *it;
+            const auto common = _commonLength(child->prefix, text, pos);
+            if (common < child->prefix.size())
+            {
+                std::unique_ptr<Node> split{new Node};
+                split->prefix = child->prefix.substr(0, common);
+                child->prefix.erase(0, common);
+                split->children.push_back(std::move(child));
+                child = std::move(split);
+            }
+            node = child.get();
+            pos += common;
+        }
+        return node;
+    }
+};
+
+struct Registry::Match
+{
+    const Routes::value_type* route = nullptr;
+    size_t pos = 0; // end of the endpoint in the path
+    std::map<std::string, std::string> params;
+};
+
+Registry::Registry()
+    : _root{new Node}
+{
+}
+
+Registry::~Registry()
+{
+}
+
 bool Registry::add(const Method method, const std::string& endpoint,
                    RESTFunc func)
 {
-    if (_methods[int(method)].count(endpoint) != 0)
+    return _add(method, endpoint, {std::move(func), RESTFuncAsync()});
+}
+
+bool Registry::add(const Method method, const std::string& endpoint,
+                   RESTFuncAsync func)
+{
+    return _add(method, endpoint, {RESTFunc(), std::move(func)});
+}
+
+bool Registry::_add(const Method method, const std::string& endpoint,
+                    Function func)
+{
+    auto it = _routes.find(endpoint);
+    if (it == _routes.end())
+    {
+        it = _routes.emplace(endpoint, Route()).first;
+        try
+        {
+            _insert(*it);
+        }
+        catch (...)
+        {
+            _routes.erase(it);
+            throw;
+        }
+    }
+
+    auto& route = it->second;
+    if (route.funcs[int(method)])
         return false;
 
-    _methods[int(method)][endpoint] = func;
+    route.funcs[int(method)] = std::move(func);
+    route.allowedMethods.clear();
+    for (size_t i = 0; i < route.funcs.size(); ++i)
+    {
+        if (!route.funcs[i])
+            continue;
+        if (!route.allowedMethods.empty())
+            route.allowedMethods.append(", ");
+        route.allowedMethods.append(methodNames[i]);
+    }
     return true;
 }
 
 bool Registry::remove(const std::string& endpoint)
 {
-    bool foundMethod = false;
-    for (auto& method : _methods)
-        if (method.erase(endpoint) != 0)
-            foundMethod = true;
-    return foundMethod;
+    if (_routes.erase(endpoint) == 0)
+        return false;
+
+    // removing is rare compared to lookups, keep the tree simple
+    _rebuild();
+    return true;
 }
 
 bool Registry::contains(const Method method, const std::string& endpoint) const
 {
-    const auto& funcMap = _methods[int(method)];
-    return funcMap.count(endpoint);
+    const auto it = _routes.find(endpoint);
+    return it != _routes.end() && it->second.funcs[int(method)];
 }
 
-RESTFunc Registry::getFunction(const Method method,
-                               const std::string& endpoint) const
+Registry::Function Registry::getFunction(const Method method,
+                                         const std::string& endpoint) const
 {
-    const auto& funcMap = _methods[int(method)];
-    return funcMap.at(endpoint);
+    const auto& func = _routes.at(endpoint).funcs[int(method)];
+    if (!func)
+        throw std::out_of_range("No function for this method: " + endpoint);
+    return func;
 }
 
-std::string Registry::getAllowedMethods(const std::string& endpoint) const
+std::string Registry::getAllowedMethods(const std::string& path) const
 {
-    std::string methods;
-    if (contains(Method::GET, endpoint))
-        methods.append(methods.empty() ? "GET" : ", GET");
-    if (contains(Method::POST, endpoint))
-        methods.append(methods.empty() ? "POST" : ", POST");
-    if (contains(Method::PUT, endpoint))
-        methods.append(methods.empty() ? "PUT" : ", PUT");
-    if (contains(Method::PATCH, endpoint))
-        methods.append(methods.empty() ? "PATCH" : ", PATCH");
-    if (contains(Method::DELETE, endpoint))
-        methods.append(methods.empty() ? "DELETE" : ", DELETE");
-    if (contains(Method::OPTIONS, endpoint))
-        methods.append(methods.empty() ? "OPTIONS" : ", OPTIONS");
-    return methods;
+    Match match;
+    std::map<std::string, std::string> params;
+    _match(*_root, path, 0, Method::ALL, true, params, match);
+    return match.route ? match.route->second.allowedMethods : std::string();
 }
 
 Registry::SearchResult Registry::findEndpoint(const Method method,
                                               const std::string& path) const
 {
-    const auto& funcMap = _methods[int(method)];
-    auto it = _find(funcMap, path);
-    if (it != funcMap.end())
-        return {true, it->first};
+    Match match;
+    std::map<std::string, std::string> params;
+    _match(*_root, path, 0, method, false, params, match);
+    if (match.route)
+        return {true, match.route->first, path.substr(match.pos),
+                std::move(match.params)};
 
     if (contains(method, "/")) // "/" should be passed all unhandled requests.
-        return {true, "/"};
+        return {true, "/", path, {}};
+
+    return {false, std::string(), std::string(), {}};
+}
+
+void Registry::_insert(Routes::value_type& route)
+{
+    Node* node = _root.get();
+    for (const auto& token : _tokenize(route.first))
+    {
+        if (!token.param)
+        {
+            node = node->insert(token.text);
+            continue;
+        }
+        if (!node->param)
+        {
+            node->param.reset(new Node);
+            node->param->prefix = token.text;
+        }
+        else if (node->param->prefix != token.text)
+        {
+            throw std::invalid_argument("Parameter {" + token.text +
+                                        "} conflicts with {" +
+                                        node->param->prefix + "}");
+        }
+        node = node->param.get();
+    }
+    node->route = &route;
+}
 
-    return {false, std::string()};
+void Registry::_rebuild()
+{
+    _root.reset(new Node);
+    for (auto& route : _routes)
+        _insert(route);
 }
 
-Registry::FuncMap::const_iterator Registry::_find(
-    const Registry::FuncMap& funcMap, const std::string& path) const
+// Fixed text is tried before parameters, and the longest match wins.
+void Registry::_match(const Node& node, const std::string& path,
+                      const size_t pos, const Method method, const bool exact,
+                      std::map<std::string, std::string>& params,
+                      Match& best) const
 {
-    const auto beginsWithPath = [&path](const FuncMap::value_type& pair) {
-        const auto& endpoint = pair.first;
-        return endpoint.empty() ? path.empty() : path.find(endpoint) == 0;
-    };
-    return std::find_if(funcMap.begin(), funcMap.end(), beginsWithPath);
+    if (node.route && (!best.route || pos > best.pos))
+    {
+        const auto& route = *node.route;
+        const bool hasMethod = method == Method::ALL
+                                   ? !route.second.allowedMethods.empty()
+                                   : bool(route.second.funcs[int(method)]);
+        const bool isPrefix = !exact && !route.first.empty() &&
+                              route.first.back() == '/';
+        if (hasMethod && (pos == path.size() || isPrefix))
+        {
+            best.route = &route;
+            best.pos = pos;
+            best.params = params;
+        }
+    }
+    if (pos == path.size())
+        return;
+
+    if (const auto child = node.findChild(path[pos]))
+    {
+        const auto& prefix = child->prefix;
+        if (path.compare(pos, prefix.size(), prefix) == 0)
+            _match(*child, path, pos + prefix.size(), method, exact, params,
+                   best);
+    }
+
+    if (node.param)
+    {
+        const auto end = std::min(path.find('/', pos), path.size());
+        if (end == pos)
+            return;
+        const auto& name = node.param->prefix;
+        params[name] = path.substr(pos, end - pos);
+        _match(*node.param, path, end, method, exact, params, best);
+        params.erase(name);
+    }
 }
 
 void _append(rockets_nlohmann::json& array, std::string&& value)
@@ -114,18 +335,14 @@ void _append(rockets_nlohmann::json& array, std::string&& value)
 std::string Registry::toJson() const
 {
     auto body = rockets_nlohmann::json();
-    for (const auto& i : _methods[int(Method::GET)])
-        _append(body[i.first], "GET");
-    for (const auto& i : _methods[int(Method::POST)])
-        _append(body[i.first], "POST");
-    for (const auto& i : _methods[int(Method::PUT)])
-        _append(body[i.first], "PUT");
-    for (const auto& i : _methods[int(Method::PATCH)])
-        _append(body[i.first], "PATCH");
-    for (const auto& i : _methods[int(Method::DELETE)])
-        _append(body[i.first], "DELETE");
-    for (const auto& i : _methods[int(Method::OPTIONS)])
-        _append(body[i.first], "OPTIONS");
+    for (size_t i = 0; i < methodNames.size(); ++i)
+    {
+        for (const auto& route : _routes)
+        {
+            if (route.second.funcs[i])
+                _append(body[route.first], methodNames[i]);
+        }
+    }
     return body.dump(4);
 }
 }
@@ -22,11 +22,14 @@
 #ifndef ROCKETS_HTTP_REGISTRY_H
 #define ROCKETS_HTTP_REGISTRY_H
 
+#include "response.h"
 #include "types.h"
 
 #include <array>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace rockets
 {
@@ -34,36 +37,75 @@ namespace http
 {
 /**
  * Registry for HTTP endpoints.
+ *
+ * Endpoints are matched in a radix tree, in time proportional to the length
+ * of the path rather than the number of endpoints. The longest matching
+ * endpoint wins: an exact match, or a prefix match with an endpoint ending
+ * with a slash. Endpoints may contain "{name}" parameters matching one path
+ * segment, e.g. "users/{id}/posts/", fixed segments are preferred over them.
  */
 class Registry
 {
 public:
+    /** The function of an endpoint, either returning or calling back. */
+    struct Function
+    {
+        RESTFunc func;
+        RESTFuncAsync funcAsync;
+
+        explicit operator bool() const { return func || funcAsync; }
+    };
+
+    Registry();
+    ~Registry();
+
+    /**
+     * @return false if the endpoint already has a function for the method.
+     * @throw std::invalid_argument if a parameter is not a whole segment, or
+     *        is named differently than the one of an existing endpoint.
+     */
     bool add(Method method, const std::string& endpoint, RESTFunc func);
+    bool add(Method method, const std::string& endpoint, RESTFuncAsync func);
     bool remove(const std::string& endpoint);
 
     bool contains(Method method, const std::string& endpoint) const;
-    RESTFunc getFunction(Method method, const std::string& endpoint) const;
+    Function getFunction(Method method, const std::string& endpoint) const;
 
-    std::string getAllowedMethods(const std::string& endpoint) const;
+    /** @return the methods of the endpoint exactly matching the path. */
+    std::string getAllowedMethods(const std::string& path) const;
 
     struct SearchResult
     {
         bool found;
         std::string endpoint;
+        std::string path; // after the endpoint
+        std::map<std::string, std::string> params;
     };
     SearchResult findEndpoint(Method method, const std::string& path) const;
 
     std::string toJson() const;
 
 private:
-    // key stores endpoints of Serializable objects lower-case, hyphenated,
-    // with '/' separators
-    // must be an ordered map in order to iterate from the most specific path
-    using FuncMap = std::map<std::string, RESTFunc, std::greater<std::string>>;
-    std::array<FuncMap, size_t(Method::ALL)> _methods;
-
-    FuncMap::const_iterator _find(const Registry::FuncMap& FuncMap,
-                                  const std::string& path) const;
+    struct Route
+    {
+        std::array<Function, size_t(Method::ALL)> funcs;
+        std::string allowedMethods; // cached for 405 and CORS responses
+    };
+    using Routes = std::map<std::string, Route>;
+
+    struct Node;
+    struct Match;
+
+    Routes _routes; // by endpoint
+    std::unique_ptr<Node> _root;
+
+    bool _add(Method method, const std::string& endpoint, Function func);
+    void _insert(Routes::value_type& route);
+    void _rebuild();
+    void _match(const Node& node, const std::string& path, size_t pos,
+                Method method, bool exact,
+                std::map<std::string, std::string>& params,
+                Match& best) const;
 };
 }
 }
@@ -51,6 +51,15 @@ namespace http
  * "api/windows/"      || "api/windows/jf321f?size=4"  || "size=4" || "jf321"
  *
  * The body is the HTTP request payload.
+ *
+ * The params are the path segments matching the "{name}" parameters of the
+ * registered endpoint.
+ * Registered endpoint || HTTP request        || params         || path
+ * "users/{id}"        || "users/42"          || {"id": "42"}   || ""
+ * "users/{id}/"       || "users/42/avatar"   || {"id": "42"}   || "avatar"
+ *
+ * The headers are the conditional and Accept-Encoding request headers sent by
+ * the client, which are the only ones of the Header enum read from a request.
  */
 struct Request
 {
@@ -60,6 +69,8 @@ struct Request
     std::string host;
     std::map<std::string, std::string> query;
     std::string body;
+    std::map<std::string, std::string> params;
+    std::map<Header, std::string> headers;
 };
 } // namespace http
 } // namespace rockets
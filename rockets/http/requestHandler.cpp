@@ -52,6 +52,7 @@ void RequestHandler::readResponseHeaders()
 #endif
     response.headers = channel.readResponseHeaders();
     responseLength = channel.readContentLength();
+    responseChunked = channel.isResponseChunked();
 }
 
 void RequestHandler::appendToResponseBody(const char* data, const size_t size)
@@ -73,7 +74,7 @@ void RequestHandler::abort(std::string&& errorMessage)
 
 bool RequestHandler::hasResponseBody() const
 {
-    return responseLength > 0;
+    return responseLength > 0 || responseChunked;
 }
 }
 }
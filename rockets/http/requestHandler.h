@@ -60,6 +60,7 @@ private:
     std::function<void(std::string)> errorCallback;
     Response response;
     size_t responseLength = 0;
+    bool responseChunked = false;
 };
 }
 }
@@ -45,6 +45,22 @@ struct Response
     using Headers = std::map<Header, std::string>;
     Headers headers;
 
+    /**
+     * Producer of the payload, which replaces the body if set.
+     *
+     * The payload is sent in parts, one each time the socket becomes writable,
+     * so that it never has to be held in memory at once. The producer may be
+     * called after the handler returned.
+     */
+    BodyCallback producer;
+
+    /**
+     * Size of the payload of the producer if known in advance, which is then
+     * sent with a Content-Length instead of chunked transfer-encoding. 0 if
+     * unknown.
+     */
+    size_t producerSize = 0;
+
     /** Construct a Response with a given return code and payload. */
     Response(const Code code_ = Code::OK, std::string body_ = std::string())
         : code{code_}
@@ -44,14 +44,20 @@ enum class Method
     ALL //!< @internal, must be last
 };
 
-/** HTTP headers which can be used in a Response. */
+/** HTTP headers which can be used in a Response, or read from a Request. */
 enum class Header
 {
     ALLOW,
     CONTENT_TYPE,
     LAST_MODIFIED,
     LOCATION,
-    RETRY_AFTER
+    RETRY_AFTER,
+    ETAG,
+    IF_MODIFIED_SINCE, //!< Request only
+    IF_NONE_MATCH,     //!< Request only
+    ACCEPT_ENCODING,   //!< Request only
+    CONTENT_ENCODING,
+    VARY
 };
 
 /** HTTP codes to be used in a Response. */
@@ -74,6 +80,7 @@ enum Code
     NOT_ACCEPTABLE = 406,
     REQUEST_TIMEOUT = 408,
     PRECONDITION_FAILED = 412,
+    PAYLOAD_TOO_LARGE = 413,
     UNSATISFIABLE_RANGE = 416,
     INTERNAL_SERVER_ERROR = 500,
     NOT_IMPLEMENTED = 501,
@@ -82,8 +89,58 @@ enum Code
     SPACE_UNAVAILABLE = 507
 };
 
+/**
+ * The gzip / deflate compression of HTTP response bodies, for the clients
+ * accepting it in their Accept-Encoding header.
+ *
+ * Streamed bodies and bodies with a Content-Encoding are sent as they are.
+ * The ETag of compressed responses is made weak.
+ */
+struct Compression
+{
+    bool enabled = false;
+
+    /** The zlib compression level, from 1 (fastest) to 9 (smallest). */
+    int level = 6;
+
+    /** The size in bytes below which bodies are sent uncompressed. */
+    size_t minSize = 1024;
+
+    /**
+     * The maximum total size of the compressed GET responses kept with their
+     * uncompressed body, so that unchanged responses are not compressed
+     * again. 0 to disable.
+     */
+    size_t cacheSize = 16 * 1024 * 1024;
+};
+
 /** HTTP REST callback with Request parameter returning a Response future. */
 using RESTFunc = std::function<std::future<Response>(const Request&)>;
+
+/**
+ * Callback for asynchronously responding to a Request, from any thread.
+ *
+ * Only the first call is used. If the callback is destroyed without being
+ * called, the client receives 500 "Internal Server Error".
+ */
+using ResponseCallback = std::function<void(Response)>;
+
+/**
+ * HTTP REST callback with Request parameter and a callback for its delayed
+ * Response. The service thread sending the response is only woken up once
+ * the callback was called.
+ */
+using RESTFuncAsync = std::function<void(const Request&, ResponseCallback)>;
+
+/**
+ * Producer of a Response body sent in chunks, called from the thread writing
+ * the response until it returns 0.
+ *
+ * @param data buffer to fill with the next part of the body.
+ * @param size of the buffer.
+ * @return the number of bytes written to the buffer, 0 at the end.
+ */
+using BodyCallback = std::function<size_t(char* data, size_t size)>;
 }
 }
 
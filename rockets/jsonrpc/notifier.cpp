@@ -30,5 +30,17 @@ void Notifier::notify(const std::string& method, const std::string& params)
     _send(params.empty() ? makeNotification(method)
                          : makeNotification(method, params));
 }
+
+void Notifier::publish(const std::string& topic, const std::string& method,
+                       const std::string& params)
+{
+    _publish(topic, params.empty() ? makeNotification(method)
+                                   : makeNotification(method, params));
+}
+
+void Notifier::_publish(const std::string&, std::string json)
+{
+    _send(std::move(json));
+}
 }
 }
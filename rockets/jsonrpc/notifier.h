@@ -54,8 +54,35 @@ public:
         notify(method, to_json(params));
     }
 
+    /**
+     * Emit a notification to the clients subscribed to a topic.
+     *
+     * @param topic of the notification.
+     * @param method to call.
+     * @param params for the notification.
+     */
+    void publish(const std::string& topic, const std::string& method,
+                 const std::string& params);
+
+    /**
+     * Emit a notification to a topic using a JSON-serializable object.
+     *
+     * @param topic of the notification.
+     * @param method to call.
+     * @param params object to send.
+     */
+    template <typename Params>
+    void publish(const std::string& topic, const std::string& method,
+                 const Params& params)
+    {
+        publish(topic, method, to_json(params));
+    }
+
 protected:
     virtual void _send(std::string json) = 0;
+
+    /** Send to the subscribers of a topic; sends to everyone by default. */
+    virtual void _publish(const std::string& topic, std::string json);
 };
 }
 }
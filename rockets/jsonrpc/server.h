@@ -37,6 +37,10 @@ namespace jsonrpc
  * - void broadcastText(std::string message);
  *   Used for sending notifications to connected clients.
  *
+ * - void publish(std::string topic, std::string message); [optional]
+ *   Used for sending notifications to the clients subscribed to a topic. If
+ *   not provided, published notifications are sent to all clients.
+ *
  * - void handleText(ws::MessageCallback callback);
  *   Used to register a callback for processing the requests and notifications
  *   coming from the client(s).
@@ -64,6 +68,25 @@ private:
         communicator.broadcastText(std::move(json));
     }
 
+    /** Notifier::_publish */
+    void _publish(const std::string& topic, std::string json) final
+    {
+        _publish(communicator, topic, std::move(json), 0);
+    }
+
+    template <typename T>
+    static auto _publish(T& comm, const std::string& topic, std::string json,
+                         int) -> decltype(comm.publish(topic, json), void())
+    {
+        comm.publish(topic, std::move(json));
+    }
+
+    template <typename T>
+    static void _publish(T& comm, const std::string&, std::string json, long)
+    {
+        comm.broadcastText(std::move(json));
+    }
+
     CommunicatorT& communicator;
 };
 }
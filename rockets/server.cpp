@@ -24,24 +24,56 @@
 
 #include "http/connection.h"
 #include "http/connectionHandler.h"
+#include "http/compressor.h"
+#include "http/fileServer.h"
 #include "http/registry.h"
 #include "pollDescriptors.h"
 #include "serverContext.h"
 #include "serviceThreadPool.h"
+#include "timerWheel.h"
+#include "workerPool.h"
 #include "ws/channel.h"
 #include "ws/connection.h"
 #include "ws/messageHandler.h"
 
 #include <libwebsockets.h>
 
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <mutex>
 #include <set>
 #include <sstream>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace
 {
 const std::string REQUEST_REGISTRY = "registry";
+
+// Client IDs are made of a sequence number which is never reused, tagging
+// the shard of the connection in the low bits for direct lookup. With a
+// 32-bit uintptr_t the sequence is truncated to 16 bits and wraps around.
+const unsigned int shardBits = 16;
+const uintptr_t shardMask = (uintptr_t(1) << shardBits) - 1;
+
+uintptr_t makeClientID(const uint64_t sequence, const size_t shard)
+{
+    return static_cast<uintptr_t>(sequence << shardBits) | shard;
+}
+
+size_t getShardIndex(const uintptr_t clientID)
+{
+    return clientID & shardMask;
+}
+
+// Resolution of the keepalive and idle timeouts
+const std::chrono::milliseconds timerTick{100};
+
+// Time given to unreachable clients to receive the close frame
+const unsigned int abortTimeout = 1;
 }
 
 namespace rockets
@@ -54,81 +86,936 @@ static int callback_websockets(lws* wsi, lws_callback_reasons reason,
 class Server::Impl
 {
 public:
-    Impl(const std::string& uri, const std::string& name,
-         const unsigned int threadCount, void* uvLoop)
-        : handler{registry}
-        , wsHandler(wsConnections)
+    /** A websocket message waiting to be queued on the connections. */
+    struct PendingMessage
     {
-        context =
-            std::make_unique<ServerContext>(uri, name, threadCount,
-                                            callback_http, callback_websockets,
-                                            this, uvLoop);
-        if (threadCount > 0)
-            serviceThreadPool = std::make_unique<ServiceThreadPool>(*context);
+        ws::PayloadPtr payload; // shared by all recipients, never copied
+        ws::OverflowPolicy policy;
+        uintptr_t client; // only send to this client, or to all if 0
+        std::set<uintptr_t> filter;
+        std::string key; // replaces the unsent message with the same key
+        std::string topic; // only send to the subscribers of this topic
+        ws::StreamCallback stream; // instead of the payload, for one client
+        bool frame; // replaces the unsent frame of the stream named by key
+
+        bool isFor(const uintptr_t clientID) const
+        {
+            if (client != 0)
+                return client == clientID;
+            return filter.find(clientID) == filter.end();
+        }
+    };
+    using PendingMessagePtr = std::shared_ptr<const PendingMessage>;
+
+    using Clients = std::unordered_map<uintptr_t, ws::ConnectionPtr>;
+
+    /** A request waiting for room in the worker queue. */
+    struct DeferredTask
+    {
+        const void* connection;
+        WorkerPool::Task task;
+        std::function<void(bool)> setReceiveEnabled;
+    };
+
+    /**
+     * The connections owned by one service thread (of any context).
+     *
+     * All lws callbacks for a connection happen on the service thread that
+     * owns it, so only this thread modifies the connection maps and the
+     * connection queues. Other threads post their messages to the pending
+     * list, which is then processed by the owner thread.
+     *
+     * Other threads find the clients in a read-copy-update snapshot, which
+     * they read without lock. Only connecting and disconnecting clients pay
+     * for copying it.
+     */
+    struct Shard
+    {
+        std::map<lws*, http::Connection> connections;
+        ws::Connections wsConnections;
+        std::shared_ptr<const Clients> clients{std::make_shared<Clients>()};
+
+        mutable std::mutex mutex; // pending messages and subscriptions
+        std::vector<PendingMessagePtr> pending;
+        std::vector<lws*> responses; // ready delayed HTTP responses
+
+        // topic -> subscribers index, and its reverse for closing connections
+        std::map<std::string, std::set<ws::Connection*>> subscribers;
+        std::map<ws::Connection*, std::set<std::string>> topics;
+
+        std::deque<DeferredTask> deferred; // owner thread only
+        TimerWheel timers{timerTick};      // owner thread only, by client ID
+    };
+
+    Impl(const ServerOptions& options_, void* uvLoop)
+        : options{options_}
+        , handler{registry}
+        , shardCount{std::max(1u, options.threadCount) * options.contextCount}
+        , shards{new Shard[shardCount]}
+        , wsHandler([this](const ws::Response& response,
+                           ws::ConnectionPtr sender) {
+            dispatch(response, sender);
+        })
+    {
+        if (options.workerCount > 0 && options.threadCount == 0)
+            throw std::invalid_argument("Worker threads need service threads");
+        if (options.contextCount == 0)
+            throw std::invalid_argument("Need at least one context");
+        if (options.contextCount > 1 && options.threadCount == 0)
+            throw std::invalid_argument(
+                "Multiple contexts need service threads");
+        if (shardCount > shardMask + 1)
+            throw std::invalid_argument("Too many service threads");
+        if (options.pingInterval.count() < 0 ||
+            options.pongTimeout.count() < 0 ||
+            options.idleTimeout.count() < 0 || options.blockTimeout.count() < 0)
+        {
+            throw std::invalid_argument("Negative websocket timeout");
+        }
+        checkAffinity();
+        handler.setMaxBodySize(options.maxBodySize);
+        if (options.httpCompression.enabled)
+            handler.setCompressor(&compressor);
+        handler.setNotifier([this](http::Connection& connection) {
+            const auto index = ServiceThreadPool::getCurrentServiceIndex();
+            const auto wsi = connection.getWsi();
+            return [this, lifetime = lifetime, index, wsi] {
+                std::lock_guard<std::mutex> lock{lifetime->mutex};
+                if (lifetime->alive)
+                    notifyResponse(index, wsi);
+            };
+        });
+        wsHandler.setMaxMessageSize(options.maxMessageSize);
+
+        createContexts(uvLoop);
+        if (options.threadCount > 0)
+            startServiceThreads();
+        if (options.workerCount > 0)
+            startWorkers();
+    }
+
+    // Destroying a context closes its remaining connections, whose callbacks
+    // may post messages, so the service threads of all contexts are stopped
+    // first and the messages posted from then on are dropped. The workers are
+    // stopped in between, as the service threads give them tasks and their
+    // tasks post messages.
+    ~Impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock{lifetime->mutex};
+            lifetime->alive = false;
+        }
+        stopping = true;
+        notifyQueueSpace();
+        for (auto& pool : serviceThreadPools)
+            pool->stop();
+        workerPool.reset();
+        contexts.clear();
+        serviceThreadPools.clear();
+    }
+
+    // The first context chooses the port for the other ones, which share it
+    void createContexts(void* uvLoop)
+    {
+        contexts.push_back(std::make_unique<ServerContext>(
+            options, callback_http, callback_websockets, this, uvLoop));
+
+        auto sharedOptions = options;
+        sharedOptions.uri = parse(options.uri).host + ":" +
+                            std::to_string(contexts.front()->getPort());
+        while (contexts.size() < options.contextCount)
+            contexts.push_back(std::make_unique<ServerContext>(
+                sharedOptions, callback_http, callback_websockets, this));
+    }
+
+    void checkAffinity() const
+    {
+        const auto threadCount = options.threadCount * options.contextCount;
+        if (options.affinity.size() > threadCount)
+            throw std::invalid_argument("More affinity entries than threads");
+
+        const auto coreCount = std::thread::hardware_concurrency();
+        for (const auto& cores : options.affinity)
+        {
+            for (const auto core : cores)
+            {
+                if (coreCount > 0 && core >= coreCount)
+                    throw std::invalid_argument("Invalid core in affinity: " +
+                                                std::to_string(core));
+            }
+        }
+    }
+
+    void startServiceThreads()
+    {
+        const auto handler = [this](const int index) { processPending(index); };
+        const auto setup = [this](const int index) { placeThread(index); };
+        int firstIndex = 0;
+        for (auto& context : contexts)
+        {
+            serviceThreadPools.push_back(
+                std::make_unique<ServiceThreadPool>(*context, handler,
+                                                    firstIndex, setup));
+            firstIndex += context->getThreadCount();
+            // lws does not wake up the service threads for our timers
+            if (hasTimeouts())
+                serviceThreadPools.back()->startTicks(timerTick);
+        }
+    }
+
+    // Called by each service thread before it accepts connections, so that
+    // all its allocations happen on its final NUMA node. The thread still
+    // works if it can not be placed, only slower.
+    void placeThread(const int index) const
+    {
+        const auto i = static_cast<size_t>(index);
+        if (i < options.affinity.size() && !options.affinity[i].empty() &&
+            !setThreadAffinity(options.affinity[i]))
+        {
+            lwsl_err("rockets: could not pin service thread %d\n", index);
+        }
+        if (options.numaLocalMemory && !setLocalMemoryPolicy())
+            lwsl_err("rockets: no NUMA-local memory for service thread %d\n",
+                     index);
+    }
+
+    unsigned int getThreadCount() const
+    {
+        unsigned int count = 0;
+        for (const auto& pool : serviceThreadPools)
+            count += pool->getSize();
+        return count;
+    }
+
+    void startWorkers()
+    {
+        workerPool = std::make_unique<WorkerPool>(options.workerCount,
+                                                  options.workerQueueSize,
+                                                  [this] {
+                                                      requestBroadcast();
+                                                  });
+
+        http::Response reject{http::Code::SERVICE_UNAVAILABLE};
+        reject.headers[http::Header::RETRY_AFTER] =
+            std::to_string(options.retryAfter);
+        handler.setExecutor(
+            [this](http::Connection& connection, WorkerPool::Task task) {
+                return execute(&connection, std::move(task),
+                               [&connection](const bool enabled) {
+                                   connection.setReceiveEnabled(enabled);
+                               },
+                               options.overloadPolicy ==
+                                   OverloadPolicy::reject);
+            },
+            std::move(reject));
+
+        wsHandler.setExecutor(
+            [this](ws::ConnectionPtr connection, WorkerPool::Task task) {
+                auto conn = connection.get();
+                execute(conn, std::move(task),
+                        [conn](const bool enabled) {
+                            conn->setReceiveEnabled(enabled);
+                        },
+                        false);
+            });
+    }
+
+    size_t getShardCount() const { return shardCount; }
+    Shard& getCurrentShard()
+    {
+        return shards[ServiceThreadPool::getCurrentServiceIndex()];
+    }
+
+    // Connections are closed from the main thread when the context is
+    // destroyed, look in all shards if it is not the current one.
+    template <typename Map>
+    Shard* findShard(lws* wsi, Map Shard::*map)
+    {
+        auto& current = getCurrentShard();
+        if ((current.*map).count(wsi))
+            return &current;
+        for (size_t i = 0; i < getShardCount(); ++i)
+        {
+            if ((shards[i].*map).count(wsi))
+                return &shards[i];
+        }
+        return nullptr;
     }
 
     void requestBroadcast()
     {
-        if (serviceThreadPool)
-            serviceThreadPool->requestBroadcast();
+        if (stopping)
+            return;
+        // like the service threads, wake up the thread calling process(),
+        // which owns the connections and is the only one to process them
+        if (serviceThreadPools.empty() && !processRequested.exchange(true))
+            contexts.front()->cancelService();
+        for (auto& pool : serviceThreadPools)
+            pool->requestBroadcast();
+    }
+
+    void post(PendingMessagePtr message)
+    {
+        if (message->client != 0)
+        {
+            // unknown clients are ignored, like disconnected ones
+            const auto index = getShardIndex(message->client);
+            if (index >= getShardCount())
+                return;
+            std::lock_guard<std::mutex> lock{shards[index].mutex};
+            shards[index].pending.push_back(std::move(message));
+        }
         else
-            context->requestBroadcast();
+        {
+            for (size_t i = 0; i < getShardCount(); ++i)
+            {
+                std::lock_guard<std::mutex> lock{shards[i].mutex};
+                shards[i].pending.push_back(message);
+            }
+        }
+        requestBroadcast();
+    }
+
+    // Called from any thread once the delayed response of an HTTP connection
+    // is ready. The connection may be closed by the time it is processed.
+    void notifyResponse(const int index, lws* wsi)
+    {
+        {
+            std::lock_guard<std::mutex> lock{shards[index].mutex};
+            shards[index].responses.push_back(wsi);
+        }
+        requestBroadcast();
+    }
+
+    void post(ws::PayloadPtr payload, ws::OverflowPolicy policy,
+              const uintptr_t client = 0,
+              std::set<uintptr_t> filter = std::set<uintptr_t>(),
+              std::string key = std::string(),
+              std::string topic = std::string())
+    {
+        if (policy == ws::OverflowPolicy::unspecified)
+            policy = options.overflowPolicy;
+        auto message = std::make_shared<PendingMessage>(
+            PendingMessage{std::move(payload), policy, client,
+                           std::move(filter), std::move(key),
+                           std::move(topic), ws::StreamCallback(), false});
+        if (policy == ws::OverflowPolicy::block &&
+            !waitForQueueSpace(*message))
+        {
+            message->policy = ws::OverflowPolicy::disconnect;
+        }
+        post(std::move(message));
+    }
+
+    void post(const std::string& message, const ws::Format format,
+              const ws::OverflowPolicy policy, const uintptr_t client = 0,
+              std::set<uintptr_t> filter = std::set<uintptr_t>())
+    {
+        post(std::make_shared<ws::Payload>(message, format), policy, client,
+             std::move(filter));
+    }
+
+    // Streams are not counted in bytes, so they never wait for queue space
+    void postStream(ws::StreamCallback producer, const uintptr_t client)
+    {
+        auto message = std::make_shared<PendingMessage>();
+        message->policy = options.overflowPolicy;
+        message->client = client;
+        message->stream = std::move(producer);
+        post(std::move(message));
+    }
+
+    void postFrame(ws::PayloadPtr payload, const std::string& stream)
+    {
+        auto message = std::make_shared<PendingMessage>();
+        message->payload = std::move(payload);
+        message->key = stream;
+        message->frame = true;
+        post(std::move(message));
+    }
+
+    std::vector<uintptr_t> getRecipients(const PendingMessage& message) const
+    {
+        std::vector<uintptr_t> recipients;
+        if (message.client != 0)
+        {
+            recipients.push_back(message.client);
+            return recipients;
+        }
+        for (size_t i = 0; i < getShardCount(); ++i)
+        {
+            for (const auto& client : *getClients(shards[i]))
+            {
+                if (message.isFor(client.first))
+                    recipients.push_back(client.first);
+            }
+        }
+        return recipients;
+    }
+
+    /** Remove the clients which are gone or have room for size bytes. */
+    void removeClientsWithSpace(std::vector<uintptr_t>& clients,
+                                const size_t size) const
+    {
+        const auto hasSpace = [this, size](const uintptr_t client) {
+            bool full = false;
+            withClient(client, [&](const Shard&, const ws::Connection& conn) {
+                full = !conn.isClosing() && conn.isQueueFull(size);
+            });
+            return !full;
+        };
+        clients.erase(std::remove_if(clients.begin(), clients.end(), hasSpace),
+                      clients.end());
+    }
+
+    /**
+     * Wait until the recipients of the message have room for it, rechecking
+     * only the ones which were full whenever a queue is written to.
+     *
+     * Waiting is not possible on the threads which empty the queues.
+     *
+     * @return false if some recipients are still full after the block
+     *         timeout.
+     */
+    bool waitForQueueSpace(const PendingMessage& message)
+    {
+        if (serviceThreadPools.empty() || ServiceThreadPool::isServiceThread())
+            return true;
+
+        const auto size = message.payload->size();
+        const auto deadline =
+            std::chrono::steady_clock::now() + options.blockTimeout;
+        ++blockedSenders;
+        std::unique_lock<std::mutex> lock{queueSpaceMutex};
+        auto full = getRecipients(message);
+        removeClientsWithSpace(full, size);
+        while (!stopping && !full.empty())
+        {
+            const auto status = queueSpace.wait_until(lock, deadline);
+            removeClientsWithSpace(full, size);
+            if (status == std::cv_status::timeout)
+                break;
+        }
+        --blockedSenders;
+        return full.empty();
+    }
+
+    /**
+     * Wake up the senders blocked in waitForQueueSpace(). Taking the mutex
+     * orders the notification after a sender's last check.
+     */
+    void notifyQueueSpace()
+    {
+        if (blockedSenders == 0)
+            return;
+        {
+            std::lock_guard<std::mutex> lock{queueSpaceMutex};
+        }
+        queueSpace.notify_all();
+    }
+
+    static std::shared_ptr<const Clients> getClients(const Shard& shard)
+    {
+        return std::atomic_load(&shard.clients);
+    }
+
+    // Called by the owner thread, or the main thread once the service threads
+    // are stopped. Readers keep the previous snapshot until they are done.
+    template <typename Func>
+    static void updateClients(Shard& shard, Func modify)
+    {
+        auto clients = std::make_shared<Clients>(*shard.clients);
+        modify(*clients);
+        std::atomic_store(&shard.clients,
+                          std::shared_ptr<const Clients>(std::move(clients)));
+    }
+
+    /**
+     * Call func(shard, connection) for a connected client, without lock. The
+     * connection remains valid during the call, but it may be closing.
+     *
+     * @return false if the client is not connected.
+     */
+    template <typename Func>
+    bool withClient(const uintptr_t client, Func func) const
+    {
+        const auto index = getShardIndex(client);
+        if (client == 0 || index >= getShardCount())
+            return false;
+
+        auto& shard = shards[index];
+        const auto clients = getClients(shard);
+        const auto it = clients->find(client);
+        if (it == clients->end())
+            return false;
+        func(shard, *it->second);
+        return true;
+    }
+
+    /**
+     * Call func(shard, connection) for a connected client with the lock of
+     * its shard held, which closing connections also take before their
+     * subscriptions are removed.
+     *
+     * @return false if the client is not connected.
+     */
+    template <typename Func>
+    bool withClientLocked(const uintptr_t client, Func func) const
+    {
+        const auto index = getShardIndex(client);
+        if (client == 0 || index >= getShardCount())
+            return false;
+
+        std::lock_guard<std::mutex> lock{shards[index].mutex};
+        return withClient(client, func);
+    }
+
+    ws::FrameStats getFrameStats(const uintptr_t client) const
+    {
+        ws::FrameStats stats;
+        withClient(client, [&stats](const Shard&, ws::Connection& conn) {
+            stats = conn.getFrameStats();
+        });
+        return stats;
+    }
+
+    ws::QueueDepth getQueueDepth(const uintptr_t client) const
+    {
+        ws::QueueDepth depth;
+        withClient(client, [&depth](const Shard&, ws::Connection& conn) {
+            depth = conn.getQueueDepth();
+        });
+        return depth;
+    }
+
+    bool subscribe(const uintptr_t client, const std::string& topic)
+    {
+        return withClientLocked(client, [&topic](Shard& shard,
+                                                 ws::Connection& conn) {
+            shard.subscribers[topic].insert(&conn);
+            shard.topics[&conn].insert(topic);
+        });
+    }
+
+    bool unsubscribe(const uintptr_t client, const std::string& topic)
+    {
+        return withClientLocked(client, [&topic](Shard& shard,
+                                                 ws::Connection& conn) {
+            removeSubscription(shard, conn, topic);
+            auto& topics = shard.topics[&conn];
+            topics.erase(topic);
+            if (topics.empty())
+                shard.topics.erase(&conn);
+        });
+    }
+
+    static void removeSubscription(Shard& shard, ws::Connection& conn,
+                                   const std::string& topic)
+    {
+        auto it = shard.subscribers.find(topic);
+        if (it == shard.subscribers.end())
+            return;
+        it->second.erase(&conn);
+        if (it->second.empty())
+            shard.subscribers.erase(it);
+    }
+
+    // Called with the shard lock held.
+    static void removeSubscriptions(Shard& shard, ws::Connection& conn)
+    {
+        auto it = shard.topics.find(&conn);
+        if (it == shard.topics.end())
+            return;
+        for (const auto& topic : it->second)
+            removeSubscription(shard, conn, topic);
+        shard.topics.erase(it);
+    }
+
+    /**
+     * Queue a task for the worker threads, or defer it and pause the reading
+     * of its connection until the workers catch up. Called by the service
+     * thread owning the connection.
+     *
+     * @return false if the task was rejected.
+     */
+    bool execute(const void* connection, WorkerPool::Task&& task,
+                 std::function<void(bool)> setReceiveEnabled,
+                 const bool canReject)
+    {
+        auto& shard = getCurrentShard();
+        if (shard.deferred.empty() && workerPool->tryPost(std::move(task)))
+            return true;
+        if (canReject)
+            return false;
+
+        setReceiveEnabled(false);
+        shard.deferred.push_back(
+            {connection, std::move(task), std::move(setReceiveEnabled)});
+        return true;
+    }
+
+    void processDeferred(Shard& shard)
+    {
+        while (!shard.deferred.empty() &&
+               workerPool->tryPost(std::move(shard.deferred.front().task)))
+        {
+            shard.deferred.front().setReceiveEnabled(true);
+            shard.deferred.pop_front();
+        }
+    }
+
+    void dropDeferred(Shard& shard, const void* connection)
+    {
+        auto& deferred = shard.deferred;
+        deferred.erase(std::remove_if(deferred.begin(), deferred.end(),
+                                      [connection](const DeferredTask& task) {
+                                          return task.connection == connection;
+                                      }),
+                       deferred.end());
+    }
+
+    // Called by the service thread owning the shard.
+    void processPending(const int index)
+    {
+        auto& shard = shards[index];
+        if (workerPool)
+            processDeferred(shard);
+
+        std::vector<PendingMessagePtr> pending;
+        std::vector<lws*> responses;
+        {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            pending.swap(shard.pending);
+            responses.swap(shard.responses);
+        }
+        for (const auto wsi : responses)
+        {
+            // the wsi may also have been reused by a new connection
+            const auto it = shard.connections.find(wsi);
+            if (it == shard.connections.end())
+                continue;
+            auto& connection = it->second;
+            if (connection.isResponseSet() && connection.isResponseReady() &&
+                !connection.wereResponseHeadersSent())
+            {
+                connection.requestWriteCallback();
+            }
+        }
+        for (const auto& message : pending)
+        {
+            if (!message->topic.empty())
+            {
+                publish(shard, *message);
+                continue;
+            }
+            if (message->client != 0)
+            {
+                const auto it = shard.clients->find(message->client);
+                if (it != shard.clients->end())
+                    send(*it->second, *message);
+                continue;
+            }
+            for (auto& connection : shard.wsConnections)
+            {
+                auto& conn = *connection.second;
+                if (message->isFor(conn.getClientID()))
+                    send(conn, *message);
+            }
+        }
+        processTimers(shard);
+    }
+
+    // Called by the thread calling process(), without service threads.
+    void processMainShard()
+    {
+        if (processRequested.exchange(false))
+            processPending(0);
+        else
+            processTimers(shards[0]);
+    }
+
+    bool hasTimeouts() const
+    {
+        return options.pingInterval.count() > 0 ||
+               options.idleTimeout.count() > 0;
+    }
+
+    std::chrono::milliseconds getPongTimeout() const
+    {
+        return options.pongTimeout.count() > 0 ? options.pongTimeout
+                                               : options.pingInterval;
+    }
+
+    // Called by the service thread owning the shard.
+    void processTimers(Shard& shard)
+    {
+        if (!hasTimeouts())
+            return;
+        shard.timers.advance(TimerWheel::Clock::now(),
+                             [this, &shard](const uintptr_t client) {
+                                 checkActivity(shard, client);
+                             });
+    }
+
+    // Timers are not cancelled, so they may expire for closed clients or
+    // clients which were active since the timer was scheduled.
+    void checkActivity(Shard& shard, const uintptr_t client)
+    {
+        const auto it = shard.clients->find(client);
+        if (it == shard.clients->end() || it->second->isClosing())
+            return;
+
+        auto& connection = *it->second;
+        auto& activity = connection.getActivity();
+        const auto now = shard.timers.getTime();
+        if (options.idleTimeout.count() > 0 &&
+            now - activity.lastMessage >= options.idleTimeout)
+        {
+            connection.close(LWS_CLOSE_STATUS_GOINGAWAY, "idle timeout");
+            return;
+        }
+        if (activity.awaitingPong &&
+            now - activity.pingSent >= getPongTimeout())
+        {
+            connection.abort(LWS_CLOSE_STATUS_GOINGAWAY, "ping timeout",
+                             abortTimeout);
+            return;
+        }
+        if (options.pingInterval.count() > 0 && !activity.awaitingPong &&
+            now - activity.lastReceived >= options.pingInterval)
+        {
+            connection.ping();
+            activity.awaitingPong = true;
+            activity.pingSent = now;
+        }
+        shard.timers.schedule(client, getNextCheck(activity));
+    }
+
+    ws::Activity::TimePoint getNextCheck(const ws::Activity& activity) const
+    {
+        auto next = ws::Activity::TimePoint::max();
+        if (options.idleTimeout.count() > 0)
+            next = std::min(next, activity.lastMessage + options.idleTimeout);
+        if (activity.awaitingPong)
+            next = std::min(next, activity.pingSent + getPongTimeout());
+        else if (options.pingInterval.count() > 0)
+            next = std::min(next, activity.lastReceived + options.pingInterval);
+        return next;
+    }
+
+    static void send(ws::Connection& conn, const PendingMessage& message)
+    {
+        if (message.frame)
+            conn.sendFrame(message.payload, message.key);
+        else if (message.stream)
+            conn.sendStream(message.stream, message.policy);
+        else
+            conn.sendLatest(message.payload, message.key, message.policy);
+    }
+
+    // Subscribers are copied because callbacks may change subscriptions, but
+    // only the owner thread closes them so they remain valid.
+    void publish(Shard& shard, const PendingMessage& message)
+    {
+        std::vector<ws::Connection*> recipients;
+        {
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            const auto it = shard.subscribers.find(message.topic);
+            if (it == shard.subscribers.end())
+                return;
+            recipients.assign(it->second.begin(), it->second.end());
+        }
+        for (auto conn : recipients)
+            conn->sendLatest(message.payload, message.key, message.policy);
+    }
+
+    void dispatch(const ws::Response& response, ws::ConnectionPtr sender)
+    {
+        if (response.format == ws::Format::unspecified)
+            return;
+
+        const auto senderID = sender->getClientID();
+        const auto format = response.format;
+        const auto policy = ws::OverflowPolicy::unspecified;
+        switch (response.recipient)
+        {
+        case ws::Recipient::sender:
+            post(response.message, format, policy, senderID);
+            break;
+        case ws::Recipient::others:
+            post(response.message, format, policy, 0, {senderID});
+            break;
+        case ws::Recipient::all:
+        default:
+            post(response.message, format, policy);
+        }
     }
 
     void openWsConnection(lws* wsi)
     {
-        std::lock_guard<std::mutex> lock{wsConnectionsMutex};
-        auto connection = std::make_shared<ws::Connection>(
-            std::make_unique<ws::Channel>(wsi));
-        wsConnections.emplace(wsi, connection);
+        auto channel = std::make_unique<ws::Channel>(wsi);
+        channel->setCompression(options.compression, false);
+        const auto index = ServiceThreadPool::getCurrentServiceIndex();
+        const auto clientID = makeClientID(++clientSequence, index);
+        auto connection =
+            std::make_shared<ws::Connection>(std::move(channel), clientID);
+        auto onHighWater = [this, clientID](const ws::QueueDepth depth) {
+            if (highWaterCallback)
+                highWaterCallback(clientID, depth);
+        };
+        connection->setQueueLimits(queueLimits, onHighWater);
+        auto& shard = getCurrentShard();
+        shard.wsConnections.emplace(wsi, connection);
+        updateClients(shard, [&](Clients& clients) {
+            clients.emplace(clientID, connection);
+        });
+        if (hasTimeouts())
+        {
+            auto& activity = connection->getActivity();
+            activity.lastReceived = TimerWheel::Clock::now();
+            activity.lastMessage = activity.lastReceived;
+            shard.timers.schedule(clientID, getNextCheck(activity));
+        }
         wsHandler.handleOpenConnection(connection);
     }
 
     void closeWsConnection(lws* wsi)
     {
-        std::lock_guard<std::mutex> lock{wsConnectionsMutex};
-        wsHandler.handleCloseConnection(wsConnections.at(wsi));
-        wsConnections.erase(wsi);
+        auto shard = findShard(wsi, &Shard::wsConnections);
+        if (!shard)
+            return;
+
+        const auto connection = shard->wsConnections.at(wsi);
+        shard->wsConnections.erase(wsi);
+        {
+            std::lock_guard<std::mutex> lock{shard->mutex};
+            updateClients(*shard, [&](Clients& clients) {
+                clients.erase(connection->getClientID());
+            });
+            removeSubscriptions(*shard, *connection);
+        }
+        dropDeferred(*shard, connection.get());
+        notifyQueueSpace();
+        wsHandler.handleCloseConnection(connection);
     }
 
     void handleReceive(lws* wsi, const char* data, const size_t len)
     {
-        std::lock_guard<std::mutex> lock{wsConnectionsMutex};
-        wsHandler.handleMessage(wsConnections.at(wsi), data, len);
+        auto connection = getCurrentShard().wsConnections.at(wsi);
+        if (hasTimeouts())
+        {
+            auto& activity = connection->getActivity();
+            activity.lastReceived = TimerWheel::Clock::now();
+            activity.lastMessage = activity.lastReceived;
+            activity.awaitingPong = false;
+        }
+        wsHandler.handleMessage(connection, data, len);
+    }
+
+    void handlePong(lws* wsi)
+    {
+        auto& activity = getCurrentShard().wsConnections.at(wsi)->getActivity();
+        activity.lastReceived = TimerWheel::Clock::now();
+        activity.awaitingPong = false;
+    }
+
+    int handleWrite(lws* wsi)
+    {
+        auto& connection = *getCurrentShard().wsConnections.at(wsi);
+        if (!connection.writeMessages())
+            return -1;
+        notifyQueueSpace();
+        return 0;
+    }
+
+    size_t getConnectionCount() const
+    {
+        size_t count = 0;
+        for (size_t i = 0; i < getShardCount(); ++i)
+            count += getClients(shards[i])->size();
+        return count;
     }
 
-    void handleWrite(lws* wsi)
+    void closeHttpConnection(lws* wsi)
     {
-        std::lock_guard<std::mutex> lock{wsConnectionsMutex};
-        wsConnections.at(wsi)->writeMessages();
+        if (auto shard = findShard(wsi, &Shard::connections))
+        {
+            dropDeferred(*shard, &shard->connections.at(wsi));
+            shard->connections.erase(wsi);
+        }
     }
 
+    const ServerOptions options;
+    const ws::QueueLimits queueLimits{options.maxQueueMessages,
+                                      options.maxQueueBytes,
+                                      options.queueHighWaterBytes,
+                                      options.overflowPolicy};
+    ws::QueueCallback highWaterCallback;
+
+    std::atomic<uint64_t> clientSequence{0};
+    std::atomic<size_t> blockedSenders{0};
+    std::atomic_bool stopping{false};
+    std::atomic_bool processRequested{false}; // without service threads
+    std::mutex queueSpaceMutex;
+    std::condition_variable queueSpace;
+
+    // Response callbacks kept by the handlers may outlive the Impl, the ready
+    // responses they notify are ignored once it is destroyed.
+    struct Lifetime
+    {
+        std::mutex mutex;
+        bool alive = true;
+    };
+    const std::shared_ptr<Lifetime> lifetime = std::make_shared<Lifetime>();
+
+    // before the registry, whose handlers use it
+    http::FileServer fileServer{options.fileCacheSize};
     http::Registry registry;
+    http::Compressor compressor{options.httpCompression};
     http::ConnectionHandler handler;
-    std::map<lws*, http::Connection> connections;
 
-    std::mutex wsConnectionsMutex;
-    ws::Connections wsConnections;
+    const size_t shardCount;
+    std::unique_ptr<Shard[]> shards;
     ws::MessageHandler wsHandler;
 
     PollDescriptors pollDescriptors;
-    std::unique_ptr<ServerContext> context;
-    std::unique_ptr<ServiceThreadPool> serviceThreadPool;
+    std::vector<std::unique_ptr<ServerContext>> contexts;
+    std::vector<std::unique_ptr<ServiceThreadPool>> serviceThreadPools;
+    // last, its tasks use all of the above
+    std::unique_ptr<WorkerPool> workerPool;
 };
 
+namespace
+{
+ServerOptions makeOptions(const std::string& uri, const std::string& name,
+                          const unsigned int threadCount)
+{
+    ServerOptions options;
+    options.uri = uri;
+    options.name = name;
+    options.threadCount = threadCount;
+    return options;
+}
+}
+
+Server::Server(const ServerOptions& options)
+    : _impl(new Impl(options, nullptr))
+{
+}
+
 Server::Server(const std::string& uri, const std::string& name,
                const unsigned int threadCount)
-    : _impl(new Impl(uri, name, threadCount, nullptr))
+    : Server(makeOptions(uri, name, threadCount))
 {
 }
 
 Server::Server(const unsigned int threadCount)
-    : _impl(new Impl(std::string(), std::string(), threadCount, nullptr))
+    : Server(makeOptions(std::string(), std::string(), threadCount))
 {
 }
 
 Server::Server(void* uvLoop, const std::string& uri, const std::string& name)
-    : _impl(new Impl(uri, name, 0, uvLoop))
+    : _impl(new Impl(makeOptions(uri, name, 0), uvLoop))
 {
 }
 
@@ -138,7 +1025,7 @@ Server::~Server()
 
 std::string Server::getURI() const
 {
-    const auto host = _impl->context->getHostname();
+    const auto host = _impl->contexts.front()->getHostname();
 
     std::stringstream ss;
     ss << (host.empty() ? "localhost" : host) << ":" << getPort();
@@ -147,12 +1034,17 @@ std::string Server::getURI() const
 
 uint16_t Server::getPort() const
 {
-    return _impl->context->getPort();
+    return _impl->contexts.front()->getPort();
 }
 
 unsigned int Server::getThreadCount() const
 {
-    return _impl->serviceThreadPool ? _impl->serviceThreadPool->getSize() : 0;
+    return _impl->getThreadCount();
+}
+
+unsigned int Server::getWorkerCount() const
+{
+    return _impl->workerPool ? _impl->workerPool->getSize() : 0;
 }
 
 void Server::setHttpFilter(const http::Filter* filter)
@@ -169,6 +1061,48 @@ bool Server::handle(const http::Method action, const std::string& endpoint,
     return _impl->registry.add(action, endpoint, func);
 }
 
+bool Server::handle(const http::Method action, const std::string& endpoint,
+                    http::RESTFuncAsync func)
+{
+    if (endpoint == REQUEST_REGISTRY)
+        throw std::invalid_argument("'registry' is a reserved endpoint");
+
+    return _impl->registry.add(action, endpoint, std::move(func));
+}
+
+bool Server::serveDirectory(const std::string& endpoint,
+                            const std::string& directory)
+{
+    auto& fileServer = _impl->fileServer;
+    const auto serve = [&fileServer, directory](const http::Request& request) {
+        return http::make_ready_response(fileServer.serve(directory, request));
+    };
+
+    // request paths are matched without their leading '/'
+    const auto begin = endpoint.find_first_not_of('/');
+    if (begin == std::string::npos)
+        return handle(http::Method::GET, "/", serve);
+    const auto base = endpoint.substr(begin, endpoint.find_last_not_of('/') -
+                                                 begin + 1);
+
+    // neither endpoint is added if either one is taken
+    if (_impl->registry.contains(http::Method::GET, base) ||
+        !handle(http::Method::GET, base + "/", serve))
+    {
+        return false;
+    }
+
+    // relative links of the index only work below the directory. The
+    // Location is relative too, to keep the prefix of a reverse proxy.
+    http::Response redirect{http::Code::MOVED_PERMANENTLY};
+    redirect.headers[http::Header::LOCATION] =
+        base.substr(base.rfind('/') + 1) + "/";
+    const auto redirectFunc = [redirect](const http::Request&) {
+        return http::make_ready_response(redirect);
+    };
+    return handle(http::Method::GET, base, redirectFunc);
+}
+
 bool Server::remove(const std::string& endpoint)
 {
     return _impl->registry.remove(endpoint);
@@ -199,51 +1133,102 @@ void Server::handleBinary(ws::MessageCallback callback)
     _impl->wsHandler.callbackBinary = callback;
 }
 
-void Server::broadcastText(const std::string& message)
+void Server::handleBinaryFragments(ws::FragmentCallback callback)
+{
+    _impl->wsHandler.callbackBinaryFragment = callback;
+}
+
+void Server::handleTextView(ws::MessageViewCallback callback)
+{
+    _impl->wsHandler.callbackTextView = callback;
+}
+
+void Server::handleBinaryView(ws::MessageViewCallback callback)
+{
+    _impl->wsHandler.callbackBinaryView = callback;
+}
+
+void Server::handleQueueHighWater(ws::QueueCallback callback)
 {
-    std::lock_guard<std::mutex> lock{_impl->wsConnectionsMutex};
-    for (auto& connection : _impl->wsConnections)
-        connection.second->enqueueText(message);
-    _impl->requestBroadcast();
+    _impl->highWaterCallback = callback;
 }
 
 void Server::broadcastText(const std::string& message,
-                           const std::set<uintptr_t>& filter)
+                           const ws::OverflowPolicy policy)
 {
-    std::lock_guard<std::mutex> lock{_impl->wsConnectionsMutex};
-    for (auto& connection : _impl->wsConnections)
-    {
-        auto i =
-            filter.find(reinterpret_cast<uintptr_t>(connection.second.get()));
-        if (i == filter.end())
-            connection.second->enqueueText(message);
-    }
-    _impl->requestBroadcast();
+    _impl->post(message, ws::Format::text, policy);
+}
+
+void Server::broadcastText(const std::string& message,
+                           const std::set<uintptr_t>& filter,
+                           const ws::OverflowPolicy policy)
+{
+    _impl->post(message, ws::Format::text, policy, 0, filter);
 }
 
-void Server::sendText(const std::string& message, uintptr_t client)
+void Server::broadcastLatest(const std::string& key,
+                             const std::string& message,
+                             const ws::OverflowPolicy policy)
 {
-    std::lock_guard<std::mutex> lock{_impl->wsConnectionsMutex};
-    for (auto& connection : _impl->wsConnections)
-    {
-        if (client == reinterpret_cast<uintptr_t>(connection.second.get()))
-            connection.second->enqueueText(message);
-    }
-    _impl->requestBroadcast();
+    _impl->post(std::make_shared<ws::Payload>(message, ws::Format::text),
+                policy, 0, {}, key);
+}
+
+void Server::sendText(const std::string& message, const uintptr_t client,
+                      const ws::OverflowPolicy policy)
+{
+    _impl->post(message, ws::Format::text, policy, client);
+}
+
+void Server::broadcastBinary(const char* data, const size_t size,
+                             const ws::OverflowPolicy policy)
+{
+    _impl->post(std::make_shared<ws::Payload>(data, size, ws::Format::binary),
+                policy);
+}
+
+void Server::streamBinary(ws::StreamCallback producer, const uintptr_t client)
+{
+    _impl->postStream(std::move(producer), client);
+}
+
+void Server::broadcastFrame(const std::string& stream, const char* data,
+                            const size_t size)
+{
+    _impl->postFrame(
+        std::make_shared<ws::Payload>(data, size, ws::Format::binary), stream);
+}
+
+ws::FrameStats Server::getFrameStats(const uintptr_t client) const
+{
+    return _impl->getFrameStats(client);
+}
+
+ws::QueueDepth Server::getQueueDepth(const uintptr_t client) const
+{
+    return _impl->getQueueDepth(client);
+}
+
+bool Server::subscribe(const uintptr_t client, const std::string& topic)
+{
+    return _impl->subscribe(client, topic);
 }
 
-void Server::broadcastBinary(const char* data, const size_t size)
+bool Server::unsubscribe(const uintptr_t client, const std::string& topic)
 {
-    std::lock_guard<std::mutex> lock{_impl->wsConnectionsMutex};
-    for (auto& connection : _impl->wsConnections)
-        connection.second->enqueueBinary({data, size});
-    _impl->requestBroadcast();
+    return _impl->unsubscribe(client, topic);
+}
+
+void Server::publish(const std::string& topic, const std::string& message,
+                     const ws::OverflowPolicy policy)
+{
+    _impl->post(std::make_shared<ws::Payload>(message, ws::Format::text),
+                policy, 0, {}, std::string(), topic);
 }
 
 size_t Server::getConnectionCount() const
 {
-    std::lock_guard<std::mutex> lock{_impl->wsConnectionsMutex};
-    return _impl->wsConnections.size();
+    return _impl->getConnectionCount();
 }
 
 void Server::_setSocketListener(SocketListener* listener)
@@ -253,14 +1238,16 @@ void Server::_setSocketListener(SocketListener* listener)
 
 void Server::_processSocket(const SocketDescriptor fd, const int events)
 {
-    _impl->context->service(_impl->pollDescriptors, fd, events);
+    _impl->contexts.front()->service(_impl->pollDescriptors, fd, events);
+    _impl->processMainShard();
 }
 
 void Server::_process(const int timeout_ms)
 {
-    if (_impl->serviceThreadPool)
+    if (!_impl->serviceThreadPools.empty())
         throw std::logic_error("No process() when using service threads");
-    _impl->context->service(timeout_ms);
+    _impl->contexts.front()->service(timeout_ms);
+    _impl->processMainShard();
 }
 
 static int callback_http(lws* wsi, const lws_callback_reasons reason,
@@ -271,7 +1258,7 @@ static int callback_http(lws* wsi, const lws_callback_reasons reason,
     {
         auto impl = static_cast<Server::Impl*>(protocol->user);
         const auto& handler = impl->handler;
-        auto& connections = impl->connections;
+        auto& connections = impl->getCurrentShard().connections;
 
         switch (reason)
         {
@@ -297,12 +1284,22 @@ static int callback_http(lws* wsi, const lws_callback_reasons reason,
             if (connections.count(wsi))
                 return handler.writeResponse(connections.at(wsi));
             break;
+#if LWS_LIBRARY_VERSION_NUMBER >= 3000000
+        case LWS_CALLBACK_TIMER: // polling a delayed response
+            if (connections.count(wsi))
+                connections.at(wsi).requestWriteCallback();
+            break;
+        case LWS_CALLBACK_EVENT_WAIT_CANCELLED: // libuv loops skip process()
+            if (impl->serviceThreadPools.empty())
+                impl->processMainShard();
+            break;
+#endif
 
 #if LWS_LIBRARY_VERSION_NUMBER >= 2001000
         case LWS_CALLBACK_HTTP_DROP_PROTOCOL: // fall-through
 #endif
         case LWS_CALLBACK_CLOSED_HTTP:
-            connections.erase(wsi);
+            impl->closeHttpConnection(wsi);
             break;
 
         case LWS_CALLBACK_ADD_POLL_FD:
@@ -340,9 +1337,11 @@ static int callback_websockets(lws* wsi, const lws_callback_reasons reason,
         case LWS_CALLBACK_RECEIVE:
             impl->handleReceive(wsi, (const char*)in, len);
             break;
-        case LWS_CALLBACK_SERVER_WRITEABLE:
-            impl->handleWrite(wsi);
+        case LWS_CALLBACK_RECEIVE_PONG:
+            impl->handlePong(wsi);
             break;
+        case LWS_CALLBACK_SERVER_WRITEABLE:
+            return impl->handleWrite(wsi);
         default:
             break;
         }
@@ -25,6 +25,7 @@
 #include <rockets/http/filter.h>
 #include <rockets/http/helpers.h>
 #include <rockets/http/request.h>
+#include <rockets/serverOptions.h>
 #include <rockets/socketBasedInterface.h>
 #include <rockets/ws/types.h>
 
@@ -68,6 +69,20 @@ public:
                        unsigned int threadCount = 0);
     ROCKETS_API explicit Server(unsigned int threadCount = 0);
 
+    /**
+     * Construct a new server with the given options.
+     *
+     * With worker threads, the registered HTTP and websocket message callbacks
+     * are executed by the workers, possibly concurrently for the same client.
+     * The open and close callbacks remain on the service threads.
+     *
+     * @param options the server configuration.
+     * @throw std::runtime_error on malformed URI or connection issues.
+     * @throw std::invalid_argument if workers are requested without service
+     *        threads.
+     */
+    ROCKETS_API explicit Server(const ServerOptions& options);
+
     /**
      * Construct a new server and integrate it to a libuv loop.
      *
@@ -96,9 +111,12 @@ public:
     /** @return the server port. */
     ROCKETS_API uint16_t getPort() const;
 
-    /** @return the number of internal service threads. */
+    /** @return the number of internal service threads of all contexts. */
     ROCKETS_API unsigned int getThreadCount() const;
 
+    /** @return the number of worker threads executing the callbacks. */
+    ROCKETS_API unsigned int getWorkerCount() const;
+
     /**
      * Set a filter for HTTP requests.
      *
@@ -122,6 +140,23 @@ public:
     ROCKETS_API bool handle(http::Method method, const std::string& endpoint,
                             http::RESTFunc func);
 
+    /**
+     * Handle a single method on a given endpoint with a delayed response.
+     *
+     * The response is sent as soon as the callback is called, from any
+     * thread, without polling for it. The callback must not be called after
+     * the server is destroyed.
+     *
+     * @param method to handle
+     * @param endpoint the endpoint to receive requests for during receive().
+     * @param func the callback function for serving the request.
+     * @return true if subscription was successful.
+     * @throw std::invalid_argument if attempting to register "registry"
+     *        endpoint.
+     */
+    ROCKETS_API bool handle(http::Method method, const std::string& endpoint,
+                            http::RESTFuncAsync func);
+
     /**
      * Handle a JSON-serializable object.
      *
@@ -169,6 +204,28 @@ public:
         });
     }
 
+    /**
+     * Serve the files of a directory on GET requests.
+     *
+     * Files are read in parts as they are sent, small ones are cached up to
+     * ServerOptions::fileCacheSize. Responses have a Content-Type guessed from
+     * the file extension, an ETag and a Last-Modified header; conditional
+     * requests for unchanged files are answered with 304 "Not Modified"
+     * without reading them. Paths ending with '/' serve their "index.html".
+     * Symbolic links leading outside of the directory are not followed.
+     * Cached files are compressed according to ServerOptions::httpCompression,
+     * larger files are always sent as they are.
+     *
+     * @param endpoint below which the files are served, "" for all paths not
+     *        handled by other endpoints. The endpoint itself redirects to its
+     *        path ending with '/'.
+     * @param directory the root of the files to serve.
+     * @return false if GET is already handled for the endpoint or its path
+     *         ending with '/', in which case neither is added.
+     */
+    ROCKETS_API bool serveDirectory(const std::string& endpoint,
+                                    const std::string& directory);
+
     /**
      * Remove all handling for a given endpoint.
      *
@@ -194,24 +251,152 @@ public:
     /** Set a callback for handling binray messages from websocket clients. */
     ROCKETS_API void handleBinary(ws::MessageCallback callback);
 
-    /** Broadcast a text message to all websocket clients. */
-    ROCKETS_API void broadcastText(const std::string& message);
+    /**
+     * Set a callback for handling binary messages from websocket clients one
+     * fragment at a time as they arrive, instead of handleBinary().
+     *
+     * Large uploads can then be processed incrementally without holding the
+     * whole message in memory. The callback is called by the service thread
+     * of the client, also if workers are used, to keep the fragments in order.
+     */
+    ROCKETS_API void handleBinaryFragments(ws::FragmentCallback callback);
+
+    /**
+     * Set a callback for handling text messages without copying them, instead
+     * of handleText().
+     *
+     * Messages received in a single frame are passed directly from the receive
+     * buffer, so small messages reach the callback without heap allocation;
+     * fragmented messages are reassembled first. The callback is called by the
+     * service thread of the client, also if workers are used, as the data is
+     * only valid during the call.
+     */
+    ROCKETS_API void handleTextView(ws::MessageViewCallback callback);
+
+    /** Same as handleTextView() for binary messages, instead of handleBinary */
+    ROCKETS_API void handleBinaryView(ws::MessageViewCallback callback);
+
+    /**
+     * Set a callback for clients whose outgoing queue grows above
+     * ServerOptions::queueHighWaterBytes. It is called once from the service
+     * thread of the client, until the queue gets below the mark again.
+     */
+    ROCKETS_API void handleQueueHighWater(ws::QueueCallback callback);
+
+    /**
+     * Broadcast a text message to all websocket clients.
+     *
+     * The policy of this and the following send methods applies to recipients
+     * whose queue is full according to the ServerOptions limits. If
+     * unspecified, ServerOptions::overflowPolicy is used.
+     *
+     * Text messages are written before the binary messages, streams and
+     * frames queued earlier, unless one of them is already being written.
+     */
+    ROCKETS_API void broadcastText(
+        const std::string& message,
+        ws::OverflowPolicy policy = ws::OverflowPolicy::unspecified);
 
     /**
      * Broadcast a text message to all websocket clients, except the filtered
      * ones.
      */
-    ROCKETS_API void broadcastText(const std::string& message,
-                                   const std::set<uintptr_t>& filter);
+    ROCKETS_API void broadcastText(
+        const std::string& message, const std::set<uintptr_t>& filter,
+        ws::OverflowPolicy policy = ws::OverflowPolicy::unspecified);
 
-    /** Send a text message to the given client. */
-    ROCKETS_API void sendText(const std::string& message, uintptr_t client);
+    /**
+     * Broadcast a text message to all websocket clients, replacing the unsent
+     * message with the same key on each client. Fast clients receive every
+     * message, while slow ones only get the latest one for a key.
+     *
+     * @param key identifies the state the message updates, e.g. "camera".
+     * @param message the latest state.
+     * @param policy for full client queues.
+     */
+    ROCKETS_API void broadcastLatest(
+        const std::string& key, const std::string& message,
+        ws::OverflowPolicy policy = ws::OverflowPolicy::unspecified);
+
+    /**
+     * Send a text message to the given client, ignored if the client is
+     * disconnected. The client is found in constant time.
+     */
+    ROCKETS_API void sendText(
+        const std::string& message, uintptr_t client,
+        ws::OverflowPolicy policy = ws::OverflowPolicy::unspecified);
 
     /** Broadcast a binary message to all websocket clients. */
-    ROCKETS_API void broadcastBinary(const char* data, size_t size);
+    ROCKETS_API void broadcastBinary(
+        const char* data, size_t size,
+        ws::OverflowPolicy policy = ws::OverflowPolicy::unspecified);
+
+    /**
+     * Send a large binary message to the given client without holding it in
+     * memory, in fragments produced on demand.
+     *
+     * The producer is called from the thread servicing the client, once per
+     * write callback, until it returns 0. Messages sent to the client after
+     * the stream are delayed until it ends, because websocket messages can
+     * not be interleaved. If the producer throws, the client is disconnected.
+     *
+     * @param producer of the message fragments.
+     * @param client to send the message to.
+     */
+    ROCKETS_API void streamBinary(ws::StreamCallback producer,
+                                  uintptr_t client);
+
+    /**
+     * Broadcast a binary frame of a stream, e.g. a rendered image.
+     *
+     * Each client holds at most one unsent frame per stream, which the newer
+     * frame replaces, so that slow clients skip frames instead of falling
+     * behind. Frames are only written when the socket is not choked.
+     *
+     * @param stream the name of the stream.
+     * @param data the frame.
+     * @param size of the frame.
+     */
+    ROCKETS_API void broadcastFrame(const std::string& stream,
+                                    const char* data, size_t size);
+
+    /**
+     * @return the frames sent to a client with broadcastFrame(), to adapt the
+     *         frame resolution or quality to its achieved frame rate. Empty if
+     *         the client is unknown.
+     */
+    ROCKETS_API ws::FrameStats getFrameStats(uintptr_t client) const;
 
     /** @return the number of connected websockets clients. */
     ROCKETS_API size_t getConnectionCount() const;
+
+    /** @return the outgoing queue depth of a client, empty if unknown. */
+    ROCKETS_API ws::QueueDepth getQueueDepth(uintptr_t client) const;
+
+    /**
+     * Subscribe a websocket client to a topic, until it unsubscribes or
+     * disconnects.
+     *
+     * @return false if the client is not connected.
+     */
+    ROCKETS_API bool subscribe(uintptr_t client, const std::string& topic);
+
+    /**
+     * Unsubscribe a websocket client from a topic.
+     *
+     * @return false if the client is not connected.
+     */
+    ROCKETS_API bool unsubscribe(uintptr_t client, const std::string& topic);
+
+    /**
+     * Send a text message to the subscribers of a topic only.
+     *
+     * Each service thread looks up its subscribers in a topic index, so the
+     * cost depends on the number of subscribers, not of connections.
+     */
+    ROCKETS_API void publish(
+        const std::string& topic, const std::string& message,
+        ws::OverflowPolicy policy = ws::OverflowPolicy::unspecified);
     //@}
 
     class Impl; // must be public for static_cast from C callback
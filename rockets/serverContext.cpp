@@ -23,6 +23,7 @@
 #include "http/connection.h"
 #include "unavailablePortError.h"
 #include "ws/connection.h"
+#include "ws/extensions.h"
 
 #include <string.h> // memset
 
@@ -45,18 +46,18 @@ void signal_cb(uv_signal_t*, int)
 }
 #endif
 #endif
-ServerContext::ServerContext(const std::string& uri, const std::string& name,
-                             const unsigned int threadCount,
+ServerContext::ServerContext(const ServerOptions& options,
                              lws_callback_function* callback,
                              lws_callback_function* wsCallback, void* user,
                              void* uvLoop)
-    : protocols{make_protocol("http", callback, user), null_protocol()}
-    , wsProtocolName{name}
+    : protocols{make_protocol("http", callback, user, options.rxBufferSize),
+                null_protocol()}
+    , wsProtocolName{options.name}
 {
     if (!wsProtocolName.empty() && wsCallback)
-        createWebsocketsProtocol(wsCallback, user);
+        createWebsocketsProtocol(wsCallback, user, options.rxBufferSize);
 
-    fillContextInfo(uri, threadCount);
+    fillContextInfo(options);
 
 #ifdef LWS_WITH_LIBUV
     auto uvLoop_ = static_cast<uv_loop_t*>(uvLoop);
@@ -124,11 +125,6 @@ int ServerContext::getThreadCount() const
     return lws_get_count_threads(context.get());
 }
 
-void ServerContext::requestBroadcast()
-{
-    lws_callback_on_writable_all_protocol(context.get(), &protocols[1]);
-}
-
 bool ServerContext::service(const int tsi, const int timeout_ms)
 {
     return lws_service_tsi(context.get(), timeout_ms, tsi) >= 0;
@@ -151,17 +147,18 @@ void ServerContext::cancelService()
 }
 
 void ServerContext::createWebsocketsProtocol(lws_callback_function* wsCallback,
-                                             void* user)
+                                             void* user,
+                                             const size_t rxBufferSize)
 {
     protocols.insert(protocols.begin() + 1,
-                     make_protocol(wsProtocolName.c_str(), wsCallback, user));
+                     make_protocol(wsProtocolName.c_str(), wsCallback, user,
+                                   rxBufferSize));
 }
 
-void ServerContext::fillContextInfo(const std::string& uri,
-                                    const unsigned int threadCount)
+void ServerContext::fillContextInfo(const ServerOptions& options)
 {
     memset(&info, 0, sizeof(info));
-    const auto parsedUri = parse(uri);
+    const auto parsedUri = parse(options.uri);
     interface = getInterface(parsedUri.host);
     if (!interface.empty())
         info.iface = interface.c_str();
@@ -174,8 +171,18 @@ void ServerContext::fillContextInfo(const std::string& uri,
 #endif
     // header size: accommodate long "Authorization: Negotiate <kerberos token>"
     info.max_http_header_data = 8192;
+    info.extensions = ws::getExtensions(options.compression);
     // service threads
-    info.count_threads = threadCount;
+    info.count_threads = options.threadCount;
+    // let the kernel balance new connections between the contexts
+    if (options.contextCount > 1)
+    {
+#if LWS_LIBRARY_VERSION_NUMBER >= 3000000
+        info.options |= LWS_SERVER_OPTION_ALLOW_LISTEN_SHARE;
+#else
+        throw std::runtime_error("Multiple contexts require lws >= 3.0");
+#endif
+    }
 #if LWS_LIBRARY_VERSION_NUMBER < 3000000
     // https://github.com/warmcat/libwebsockets/issues/1249
     info.max_http_header_pool = 1024;
@@ -22,6 +22,7 @@
 
 #include <rockets/http/types.h>
 #include <rockets/pollDescriptors.h>
+#include <rockets/serverOptions.h>
 #include <rockets/utils.h>
 #include <rockets/wrappers.h>
 #include <rockets/ws/types.h>
@@ -39,8 +40,13 @@ namespace rockets
 class ServerContext
 {
 public:
-    ServerContext(const std::string& uri, const std::string& name,
-                  const unsigned int threadCount,
+    /**
+     * Create the context and its listening socket.
+     *
+     * If options.contextCount > 1, the listening socket is opened with
+     * SO_REUSEPORT so that other contexts can listen on the same port.
+     */
+    ServerContext(const ServerOptions& options,
                   lws_callback_function* callback,
                   lws_callback_function* wsCallback, void* user,
                   void* uvLoop = nullptr);
@@ -49,8 +55,6 @@ public:
     uint16_t getPort() const;
     int getThreadCount() const;
 
-    void requestBroadcast();
-
     bool service(int tsi, int timeout_ms);
     void service(int timeout_ms);
     void service(PollDescriptors& pollDescriptors, SocketDescriptor fd,
@@ -64,10 +68,9 @@ private:
     std::string wsProtocolName;
     LwsContextPtr context;
 
-    void fillContextInfo(const std::string& uri,
-                         const unsigned int threadCount);
+    void fillContextInfo(const ServerOptions& options);
     void createWebsocketsProtocol(lws_callback_function* wsCallback,
-                                  void* user);
+                                  void* user, size_t rxBufferSize);
 };
 }
 
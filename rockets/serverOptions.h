@@ -0,0 +1,171 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_SERVEROPTIONS_H
+#define ROCKETS_SERVEROPTIONS_H
+
+#include <rockets/http/types.h>
+#include <rockets/ws/types.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace rockets
+{
+/**
+ * Policy applied to incoming requests when the worker queue is full.
+ */
+enum class OverloadPolicy
+{
+    /**
+     * Reply to HTTP requests with 503 and a Retry-After header. Websocket
+     * messages can not be rejected individually, they pause reading instead.
+     */
+    reject,
+    /** Keep the request and stop reading from its socket until there is room */
+    pause
+};
+
+/**
+ * Configuration of a Server.
+ */
+struct ServerOptions
+{
+    /** The server address in the form "[hostname|IP|iface][:port]". */
+    std::string uri;
+
+    /** The name of the websockets protocol, disabled if empty. */
+    std::string name;
+
+    /** The number of internal service threads to use (per context). */
+    unsigned int threadCount = 0;
+
+    /**
+     * The number of independent lws contexts listening on the same port with
+     * SO_REUSEPORT, letting the kernel balance new connections between them.
+     * Each context has its own threadCount service threads, so more than one
+     * context requires threadCount > 0 and lws >= 3.0.
+     */
+    unsigned int contextCount = 1;
+
+    /**
+     * The CPU cores to pin each service thread to, indexed by service thread
+     * (all threads of the first context, then of the second, etc.). Threads
+     * without an entry are not pinned. Only supported on Linux.
+     */
+    std::vector<std::vector<unsigned int>> affinity;
+
+    /**
+     * Allocate the memory of each service thread, such as its connection
+     * buffers and queues, on its local NUMA node even if the process uses
+     * another memory policy (e.g. numactl --interleave). Useful together with
+     * the affinity. Only supported on Linux.
+     */
+    bool numaLocalMemory = false;
+
+    /**
+     * The number of worker threads executing the HTTP and websocket handlers,
+     * leaving only I/O to the service threads. Requires threadCount > 0. If 0,
+     * the handlers are executed by the service thread(s).
+     */
+    unsigned int workerCount = 0;
+
+    /** The maximum number of requests waiting for a worker thread. */
+    size_t workerQueueSize = 1024;
+
+    /** The policy to apply when the worker queue is full. */
+    OverloadPolicy overloadPolicy = OverloadPolicy::reject;
+
+    /** The Retry-After value in seconds of rejected HTTP requests. */
+    unsigned int retryAfter = 1;
+
+    /** The maximum number of messages queued per client, 0 for unlimited. */
+    size_t maxQueueMessages = 0;
+
+    /** The maximum number of bytes queued per client, 0 for unlimited. */
+    size_t maxQueueBytes = 0;
+
+    /**
+     * The number of bytes queued on a websocket client above which the
+     * Server::handleQueueHighWater() callback is called, 0 to disable.
+     */
+    size_t queueHighWaterBytes = 0;
+
+    /** The policy of send calls that do not specify one, for full queues. */
+    ws::OverflowPolicy overflowPolicy = ws::OverflowPolicy::dropOldest;
+
+    /**
+     * The longest time a send with OverflowPolicy::block waits for room,
+     * after which the clients whose queue is still full are disconnected.
+     */
+    std::chrono::milliseconds blockTimeout{10000};
+
+    /** The compression of websocket messages, if the clients support it. */
+    ws::Compression compression;
+
+    /**
+     * The size of the receive buffer of each connection, also the largest
+     * websocket frame or HTTP body chunk read at once.
+     */
+    size_t rxBufferSize = 1024 * 1024;
+
+    /**
+     * The maximum size of a websocket message, 0 for unlimited. The client is
+     * disconnected with status 1009 when a message grows larger. Messages
+     * received with handleBinaryFragments() are not limited.
+     */
+    size_t maxMessageSize = 0;
+
+    /**
+     * The maximum size of an HTTP request body, 0 for unlimited. Larger
+     * requests are answered with 413 without buffering their body.
+     */
+    size_t maxBodySize = 0;
+
+    /**
+     * The maximum total size of the files served by Server::serveDirectory()
+     * which are kept in memory, 0 to read them again for each request. Files
+     * larger than 1 MiB are always read in parts as they are sent.
+     */
+    size_t fileCacheSize = 64 * 1024 * 1024;
+
+    /** The compression of HTTP responses, if the clients accept it. */
+    http::Compression httpCompression;
+
+    /**
+     * Send a ping to websocket clients which did not send anything for this
+     * time, 0 to disable. Timeouts have a resolution of 100 ms.
+     */
+    std::chrono::milliseconds pingInterval{0};
+
+    /**
+     * The time to wait for any frame after a ping before dropping the client
+     * as unreachable, 0 to wait for one pingInterval.
+     */
+    std::chrono::milliseconds pongTimeout{0};
+
+    /**
+     * Close websocket connections which did not send any message for this
+     * time, 0 to disable. Pongs do not count as messages.
+     */
+    std::chrono::milliseconds idleTimeout{0};
+};
+}
+
+#endif
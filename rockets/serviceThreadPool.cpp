@@ -19,29 +19,32 @@
 
 #include "serviceThreadPool.h"
 
-#ifdef __linux__
-#include <sys/prctl.h>
-#endif
+#include "utils.h"
+
+#include <stdexcept>
 
 namespace
 {
-const auto serviceTimeoutMs = 50;
+// Broadcast requests wake up the service threads with lws_cancel_service(), so
+// the timeout is only needed by lws < 3.2 which checks its own timeouts when
+// lws_service returns. Newer versions ignore it and sleep until the next lws
+// scheduled event instead.
+const auto serviceTimeoutMs = 1000;
 
-void setThreadName(const std::string& name)
-{
-#ifdef __APPLE__
-    pthread_setname_np(name.c_str());
-#elif defined(__linux__)
-    prctl(PR_SET_NAME, name.c_str(), 0, 0, 0);
-#endif
-}
+thread_local int currentServiceIndex = 0;
+thread_local bool serviceThread = false;
 }
 
 namespace rockets
 {
-ServiceThreadPool::ServiceThreadPool(ServerContext& context_)
+ServiceThreadPool::ServiceThreadPool(ServerContext& context_,
+                                     BroadcastHandler handler,
+                                     const int firstIndex_, ThreadSetup setup)
     : context(context_)
-    , broadcastRequested{new std::atomic_bool[context.getThreadCount()]}
+    , broadcastHandler(std::move(handler))
+    , firstIndex(firstIndex_)
+    , threadSetup(std::move(setup))
+    , broadcastRequested{new std::atomic_bool[context.getThreadCount()]()}
 {
     start();
 }
@@ -56,28 +59,62 @@ size_t ServiceThreadPool::getSize() const
     return serviceThreads.size();
 }
 
+int ServiceThreadPool::getCurrentServiceIndex()
+{
+    return currentServiceIndex;
+}
+
+bool ServiceThreadPool::isServiceThread()
+{
+    return serviceThread;
+}
+
 void ServiceThreadPool::requestBroadcast()
 {
+    bool idle = false;
     for (size_t tsi = 0; tsi < getSize(); ++tsi)
-        broadcastRequested[tsi] = true;
+        idle = !broadcastRequested[tsi].exchange(true) || idle;
+
+    // requests are coalesced until the service threads handle them, a burst
+    // of messages only wakes them up once
+    if (idle)
+        context.cancelService();
+}
+
+void ServiceThreadPool::startTicks(const std::chrono::milliseconds interval)
+{
+    if (tickThread.joinable())
+        throw std::logic_error("Ticks already started");
+
+    tickThread = std::thread([this, interval]() {
+        setThreadName("rockets_ticks");
+        std::unique_lock<std::mutex> lock(tickMutex);
+        while (!tickCondition.wait_for(lock, interval,
+                                       [this] { return exitService.load(); }))
+        {
+            requestBroadcast();
+        }
+    });
 }
 
 void ServiceThreadPool::handleBroadcastRequest(const int tsi)
 {
-    if (broadcastRequested[tsi])
-    {
-        context.requestBroadcast();
-        broadcastRequested[tsi] = false;
-    }
+    // reset before handling to not miss requests made in the meantime
+    if (broadcastRequested[tsi].exchange(false))
+        broadcastHandler(firstIndex + tsi);
 }
 
 void ServiceThreadPool::start()
 {
     for (int tsi = 0; tsi < context.getThreadCount(); ++tsi)
     {
-        const auto name = "rockets_" + std::to_string(tsi);
+        const auto name = "rockets_" + std::to_string(firstIndex + tsi);
         serviceThreads.emplace_back(std::thread([this, tsi, name]() {
             setThreadName(name);
+            currentServiceIndex = firstIndex + tsi;
+            serviceThread = true;
+            if (threadSetup)
+                threadSetup(currentServiceIndex);
             while (context.service(tsi, serviceTimeoutMs) && !exitService)
                 handleBroadcastRequest(tsi);
         }));
@@ -86,9 +123,19 @@ void ServiceThreadPool::start()
 
 void ServiceThreadPool::stop()
 {
-    exitService = true;
+    {
+        std::lock_guard<std::mutex> lock(tickMutex);
+        exitService = true;
+    }
+    tickCondition.notify_one();
+    if (tickThread.joinable())
+        tickThread.join();
+
     context.cancelService();
     for (auto& thread : serviceThreads)
-        thread.join();
+    {
+        if (thread.joinable())
+            thread.join();
+    }
 }
 }
@@ -21,6 +21,10 @@
 #define ROCKETS_SERVICETHREADPOOL_H
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -29,27 +33,58 @@
 namespace rockets
 {
 /**
- * Service thread pool for the server.
+ * Service the lws context from one thread per service thread index (tsi).
+ *
+ * Broadcast requests are processed by each service thread for the connections
+ * it owns, by calling the given handler with its service index. The service
+ * index is firstIndex + tsi, to be unique across the pools of several contexts.
  */
 class ServiceThreadPool
 {
 public:
-    ServiceThreadPool(ServerContext& context);
+    using BroadcastHandler = std::function<void(int serviceIndex)>;
+
+    /** Called by each service thread when it starts, e.g. to pin it. */
+    using ThreadSetup = std::function<void(int serviceIndex)>;
+
+    ServiceThreadPool(ServerContext& context, BroadcastHandler handler,
+                      int firstIndex = 0, ThreadSetup setup = ThreadSetup());
     ~ServiceThreadPool();
 
     size_t getSize() const;
     void requestBroadcast();
 
+    /**
+     * Request a broadcast from all service threads at a regular interval, to
+     * process timeouts even when no other event wakes them up.
+     */
+    void startTicks(std::chrono::milliseconds interval);
+
+    /** Stop the service threads before the destruction, idempotent. */
+    void stop();
+
+    /** @return the index of the calling service thread, 0 for other threads. */
+    static int getCurrentServiceIndex();
+
+    /** @return true if called from a service thread of any pool. */
+    static bool isServiceThread();
+
 private:
     ServerContext& context;
+    BroadcastHandler broadcastHandler;
+    const int firstIndex;
+    ThreadSetup threadSetup;
     std::vector<std::thread> serviceThreads;
     std::unique_ptr<std::atomic_bool[]> broadcastRequested;
     std::atomic_bool exitService{false};
 
+    std::thread tickThread;
+    std::mutex tickMutex;
+    std::condition_variable tickCondition;
+
     void handleBroadcastRequest(int tsi);
 
     void start();
-    void stop();
 };
 }
 
@@ -0,0 +1,87 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "timerWheel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace rockets
+{
+TimerWheel::TimerWheel(const Clock::duration tick_, const size_t slotCount)
+    : tick{tick_}
+    , start{Clock::now()}
+    , slots(slotCount)
+{
+    if (tick <= Clock::duration::zero() || slotCount == 0)
+        throw std::invalid_argument("Invalid timer wheel resolution");
+}
+
+void TimerWheel::schedule(const uintptr_t key, const Clock::time_point deadline)
+{
+    const auto elapsed = std::max(deadline - start, Clock::duration::zero());
+    const auto ticks = uint64_t((elapsed + tick - Clock::duration(1)) / tick);
+    const auto due = std::max(ticks, currentTick + 1);
+    slots[due % slots.size()].push_back({key, due});
+    ++count;
+}
+
+void TimerWheel::advance(const Clock::time_point now,
+                         const ExpiryHandler& handler)
+{
+    if (now < start)
+        return;
+    const auto target = uint64_t((now - start) / tick);
+    if (target <= currentTick)
+        return;
+
+    // visiting more than one revolution would only visit the same slots again
+    const auto steps = std::min(target - currentTick, uint64_t(slots.size()));
+    for (uint64_t i = 1; i <= steps; ++i)
+    {
+        auto& slot = slots[(currentTick + i) % slots.size()];
+        const auto notDue = std::partition(slot.begin(), slot.end(),
+                                           [target](const Entry& entry) {
+                                               return entry.tick > target;
+                                           });
+        for (auto it = notDue; it != slot.end(); ++it)
+            expired.push_back(it->key);
+        slot.erase(notDue, slot.end());
+    }
+    currentTick = target;
+    count -= expired.size();
+
+    // the handler may schedule new timeouts, so call it once slots are updated
+    auto keys = std::move(expired);
+    expired.clear();
+    for (const auto key : keys)
+        handler(key);
+    keys.clear();
+    expired = std::move(keys); // keep the capacity for the next tick
+}
+
+TimerWheel::Clock::time_point TimerWheel::getTime() const
+{
+    return start + tick * Clock::rep(currentTick);
+}
+
+size_t TimerWheel::size() const
+{
+    return count;
+}
+}
@@ -0,0 +1,81 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_TIMERWHEEL_H
+#define ROCKETS_TIMERWHEEL_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace rockets
+{
+/**
+ * Hashed timing wheel for a large number of coarse timeouts.
+ *
+ * Scheduling is O(1) and each tick only visits the entries of one slot, which
+ * keeps per-connection timeouts cheap with many thousands of connections.
+ * Deadlines further away than one revolution stay in their slot until their
+ * round comes. Entries cannot be cancelled, the expiry handler is expected to
+ * check whether the timeout still applies to the given key.
+ *
+ * Not thread safe, meant to be owned and advanced by a single service thread.
+ */
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using ExpiryHandler = std::function<void(uintptr_t key)>;
+
+    /**
+     * @param tick the resolution of the timeouts.
+     * @param slotCount the number of slots of one revolution.
+     */
+    explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(100),
+                        size_t slotCount = 512);
+
+    /** Schedule a timeout for key, rounded up to the next tick. */
+    void schedule(uintptr_t key, Clock::time_point deadline);
+
+    /** Call handler for all the keys whose deadline is before now. */
+    void advance(Clock::time_point now, const ExpiryHandler& handler);
+
+    /** @return the time of the last tick, a cheap coarse clock. */
+    Clock::time_point getTime() const;
+
+    /** @return the number of scheduled timeouts. */
+    size_t size() const;
+
+private:
+    struct Entry
+    {
+        uintptr_t key;
+        uint64_t tick;
+    };
+
+    const Clock::duration tick;
+    const Clock::time_point start;
+    std::vector<std::vector<Entry>> slots;
+    uint64_t currentTick = 0;
+    size_t count = 0;
+    std::vector<uintptr_t> expired;
+};
+}
+
+#endif
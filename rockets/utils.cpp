@@ -36,6 +36,15 @@
 #include <sys/socket.h>
 #endif
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#elif defined(__APPLE__)
+#include <pthread.h>
+#endif
+
 #include <vector>
 
 namespace rockets
@@ -59,11 +68,10 @@ Uri parse(const std::string& uri)
 }
 
 lws_protocols make_protocol(const char* name, lws_callback_function* callback,
-                            void* user)
+                            void* user, const size_t rxBufferSize)
 {
     // clang-format off
-    const size_t rx_buffer_size = 1048576; // 1MB
-    return lws_protocols{ name, callback, 0, rx_buffer_size, 0, user
+    return lws_protocols{ name, callback, 0, rxBufferSize, 0, user
         #if LWS_LIBRARY_VERSION_NUMBER >= 2003000
                 , 0
         #endif
@@ -190,4 +198,37 @@ std::string getHostname()
     host[NI_MAXHOST - 1] = '\0';
     return host;
 }
+
+void setThreadName(const std::string& name)
+{
+#ifdef __APPLE__
+    pthread_setname_np(name.c_str());
+#elif defined(__linux__)
+    prctl(PR_SET_NAME, name.c_str(), 0, 0, 0);
+#endif
+}
+
+bool setThreadAffinity(const std::vector<unsigned int>& cores)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto core : cores)
+        CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cores;
+    return false;
+#endif
+}
+
+bool setLocalMemoryPolicy()
+{
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    const int MPOL_LOCAL = 4; // from <linux/mempolicy.h>, since Linux 3.8
+    return syscall(SYS_set_mempolicy, MPOL_LOCAL, nullptr, 0) == 0;
+#else
+    return false;
+#endif
+}
 }
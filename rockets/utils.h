@@ -24,6 +24,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace rockets
 {
@@ -37,13 +38,24 @@ struct Uri
 Uri parse(const std::string& uri);
 
 lws_protocols make_protocol(const char* name, lws_callback_function* callback,
-                            void* user);
+                            void* user, size_t rxBufferSize = 1024 * 1024);
 lws_protocols null_protocol();
 
 std::string getIP(const std::string& iface);
 std::string getInterface(const std::string& hostnameOrIP);
 
 std::string getHostname();
+
+void setThreadName(const std::string& name);
+
+/** @return false if the calling thread could not be pinned to the cores. */
+bool setThreadAffinity(const std::vector<unsigned int>& cores);
+
+/**
+ * Allocate the memory of the calling thread on the NUMA node it runs on.
+ * @return false if not supported.
+ */
+bool setLocalMemoryPolicy();
 }
 
 #endif
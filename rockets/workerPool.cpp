@@ -0,0 +1,94 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "workerPool.h"
+
+#include "utils.h"
+
+namespace rockets
+{
+WorkerPool::WorkerPool(const unsigned int threadCount,
+                       const size_t maxQueueSize_,
+                       std::function<void()> spaceAvailable_)
+    : maxQueueSize{maxQueueSize_}
+    , spaceAvailable{std::move(spaceAvailable_)}
+{
+    for (unsigned int i = 0; i < threadCount; ++i)
+    {
+        const auto name = "rockets_w" + std::to_string(i);
+        threads.emplace_back([this, name] {
+            setThreadName(name);
+            run();
+        });
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        exit = true;
+        tasks.clear();
+    }
+    condition.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+size_t WorkerPool::getSize() const
+{
+    return threads.size();
+}
+
+bool WorkerPool::tryPost(Task&& task)
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        if (tasks.size() >= maxQueueSize)
+        {
+            refused = true;
+            return false;
+        }
+        tasks.push_back(std::move(task));
+    }
+    condition.notify_one();
+    return true;
+}
+
+void WorkerPool::run()
+{
+    for (;;)
+    {
+        Task task;
+        bool notifySpaceAvailable = false;
+        {
+            std::unique_lock<std::mutex> lock{mutex};
+            condition.wait(lock, [this] { return exit || !tasks.empty(); });
+            if (exit)
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+            notifySpaceAvailable = refused;
+            refused = false;
+        }
+        if (notifySpaceAvailable && spaceAvailable)
+            spaceAvailable();
+        task();
+    }
+}
+}
@@ -0,0 +1,73 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_WORKERPOOL_H
+#define ROCKETS_WORKERPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rockets
+{
+/**
+ * Execute tasks on a fixed number of threads from a bounded queue.
+ */
+class WorkerPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /**
+     * Start the worker threads.
+     *
+     * @param threadCount the number of worker threads.
+     * @param maxQueueSize the maximum number of tasks waiting for a thread.
+     * @param spaceAvailable called from a worker thread when the queue has
+     *        room again after a task was refused.
+     */
+    WorkerPool(unsigned int threadCount, size_t maxQueueSize,
+               std::function<void()> spaceAvailable);
+
+    /** Stop the threads after their current task, pending tasks are dropped */
+    ~WorkerPool();
+
+    size_t getSize() const;
+
+    /** @return false if the queue is full, the task is then left untouched. */
+    bool tryPost(Task&& task);
+
+private:
+    const size_t maxQueueSize;
+    std::function<void()> spaceAvailable;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Task> tasks;
+    bool refused = false;
+    bool exit = false;
+    std::vector<std::thread> threads;
+
+    void run();
+};
+}
+
+#endif
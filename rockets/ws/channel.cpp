@@ -19,16 +19,67 @@
 
 #include "channel.h"
 
+#include "extensions.h"
+#include "payload.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
 namespace rockets
 {
 namespace ws
 {
 namespace
 {
+const int maxWindowBits = 15;
+
 lws_write_protocol _getProtocol(const Format format)
 {
     return format == Format::text ? LWS_WRITE_TEXT : LWS_WRITE_BINARY;
 }
+
+// A payload held by several connections may be written at the same time by
+// other service threads, which would all write in its headroom. The copy is
+// cheap next to the send, lws copies the unsent part anyway.
+unsigned char* _copyToThreadBuffer(const Payload& payload)
+{
+    thread_local std::vector<unsigned char> buffer;
+    if (buffer.size() < LWS_PRE + payload.size())
+        buffer.resize(LWS_PRE + payload.size());
+    std::copy(payload.data(), payload.data() + payload.size(),
+              buffer.begin() + LWS_PRE);
+    return buffer.data() + LWS_PRE;
+}
+
+#if ROCKETS_USE_DEFLATE
+// @return the window bits parameter of the first permessage-deflate offer or
+// response in the handshake headers, or the maximum if it is absent.
+int _getNegotiatedWindowBits(lws* wsi, const std::string& parameter)
+{
+    const int length = lws_hdr_total_length(wsi, WSI_TOKEN_EXTENSIONS);
+    if (length <= 0)
+        return maxWindowBits;
+    std::string header(size_t(length) + 1, '\0');
+    if (lws_hdr_copy(wsi, &header[0], length + 1, WSI_TOKEN_EXTENSIONS) < 0)
+        return maxWindowBits;
+
+    const auto offer = header.find("permessage-deflate");
+    const auto end = header.find(',', offer);
+    const auto param = header.find(parameter + "=", offer);
+    if (offer == std::string::npos || param == std::string::npos ||
+        param > end)
+    {
+        return maxWindowBits;
+    }
+    auto value = header.c_str() + param + parameter.size() + 1;
+    if (*value == '"')
+        ++value;
+    const auto bits = int(std::strtol(value, nullptr, 10));
+    return bits >= 8 && bits < maxWindowBits ? bits : maxWindowBits;
+}
+#endif
 }
 
 Channel::Channel(lws* wsi_)
@@ -46,6 +97,11 @@ void Channel::requestWrite()
     lws_callback_on_writable(wsi);
 }
 
+void Channel::setReceiveEnabled(const bool enabled)
+{
+    lws_rx_flow_control(wsi, enabled ? 1 : 0);
+}
+
 bool Channel::canWrite() const
 {
     return !lws_send_pipe_choked(wsi);
@@ -61,13 +117,92 @@ size_t Channel::getCurrentMessageRemainingSize() const
     return lws_remaining_packet_payload(wsi);
 }
 
-void Channel::write(std::string&& message, const Format format)
+void Channel::write(const Payload& payload, const bool shared)
+{
+    const auto protocol = _getProtocol(payload.getFormat());
+    const auto buffer =
+        shared ? _copyToThreadBuffer(payload) : payload.getWriteBuffer();
+    _updateCompression();
+    lws_write(wsi, buffer, payload.size(), protocol);
+}
+
+void Channel::writeFragment(unsigned char* data, const size_t size,
+                            const bool first, const bool last)
+{
+    int protocol = first ? LWS_WRITE_BINARY : LWS_WRITE_CONTINUATION;
+    if (!last)
+        protocol |= LWS_WRITE_NO_FIN;
+    if (first)
+        _updateCompression();
+    lws_write(wsi, data, size, static_cast<lws_write_protocol>(protocol));
+}
+
+void Channel::setCloseReason(const lws_close_status status,
+                             const std::string& reason)
+{
+#if LWS_LIBRARY_VERSION_NUMBER >= 2000000
+    auto data = (unsigned char*)(reason.data());
+    lws_close_reason(wsi, status, data, reason.size());
+#else
+    (void)status;
+    (void)reason;
+#endif
+}
+
+void Channel::writePing()
+{
+    unsigned char buffer[LWS_PRE + 1];
+    lws_write(wsi, buffer + LWS_PRE, 0, LWS_WRITE_PING);
+}
+
+void Channel::closeAfter(const unsigned int seconds)
+{
+    lws_set_timeout(wsi, PENDING_TIMEOUT_CLOSE_SEND, int(seconds));
+}
+
+void Channel::setCompression(const Compression& compression_, const bool client)
+{
+    compression = compression_;
+    if (!compression.enabled)
+        return;
+
+    // the peer may have limited the window used by this side to compress,
+    // which can only be lowered further
+    windowBitsOption =
+        client ? "client_max_window_bits" : "server_max_window_bits";
+#if ROCKETS_USE_DEFLATE
+    const auto negotiated = _getNegotiatedWindowBits(wsi, windowBitsOption);
+    if (compression.windowBits >= negotiated)
+        windowBitsOption = nullptr;
+#endif
+}
+
+// lws reads the options when it starts compressing the first message
+void Channel::_updateCompression()
+{
+    if (!compression.enabled || compressionConfigured)
+        return;
+
+    compressionConfigured = true;
+    if (!_setDeflateOption("compression_level", compression.level))
+    {
+        compression.enabled = false; // not negotiated by the peer
+        return;
+    }
+    if (windowBitsOption)
+        _setDeflateOption(windowBitsOption, compression.windowBits);
+}
+
+bool Channel::_setDeflateOption(const char* name, const int value)
 {
-    const auto size = message.size();
-    message.insert(0, LWS_PRE, '0');
-    auto data = (unsigned char*)(&message.data()[LWS_PRE]);
-    const auto protocol = _getProtocol(format);
-    lws_write(wsi, data, size, protocol);
+#if ROCKETS_USE_DEFLATE
+    return lws_set_extension_option(wsi, "permessage-deflate", name,
+                                    std::to_string(value).c_str()) == 0;
+#else
+    (void)name;
+    (void)value;
+    return false;
+#endif
 }
 }
 }
@@ -28,6 +28,8 @@ namespace rockets
 {
 namespace ws
 {
+class Payload;
+
 /**
  * A WebSocket communication channel.
  *
@@ -43,11 +45,55 @@ public:
     size_t getCurrentMessageRemainingSize() const;
 
     void requestWrite();
+    void setReceiveEnabled(bool enabled);
     bool canWrite() const;
-    void write(std::string&& message, Format format);
+
+    /**
+     * Write a message.
+     *
+     * @param payload the message.
+     * @param shared true if other connections hold the payload, which is then
+     *        copied instead of written in place.
+     */
+    void write(const Payload& payload, bool shared);
+
+    /**
+     * Write one fragment of a binary message.
+     *
+     * @param data to write, preceded by LWS_PRE bytes of headroom.
+     * @param size of the data, can be 0 for the last fragment.
+     * @param first fragment of the message.
+     * @param last fragment of the message.
+     */
+    void writeFragment(unsigned char* data, size_t size, bool first,
+                       bool last);
+    void setCloseReason(lws_close_status status, const std::string& reason);
+
+    /** Write an empty ping frame, answered by a pong from the peer. */
+    void writePing();
+
+    /**
+     * Close the socket after the given time even if it never becomes
+     * writable again, e.g. when the peer is unreachable.
+     */
+    void closeAfter(unsigned int seconds);
+
+    /**
+     * Configure the compression of outgoing messages, applied on the first
+     * write once the extension has been negotiated. Must be called while the
+     * handshake headers are available, the window is never made larger than
+     * the one negotiated with the peer.
+     */
+    void setCompression(const Compression& compression, bool client);
 
 private:
     lws* wsi = nullptr;
+    Compression compression;
+    const char* windowBitsOption = nullptr; // if lower than negotiated
+    bool compressionConfigured = false;
+
+    void _updateCompression();
+    bool _setDeflateOption(const char* name, int value);
 };
 }
 }
@@ -53,9 +53,11 @@ static int callback_ws(lws* wsi, lws_callback_reasons reason, void* user,
 class Client::Impl
 {
 public:
-    Impl()
-        : context{new ClientContext{callback_ws, this}}
+    Impl(const ClientOptions& options)
+        : compression{options.compression}
+        , context{new ClientContext{callback_ws, this, options}}
     {
+        messageHandler.setMaxMessageSize(options.maxMessageSize);
     }
 
     void tryToSetConnectionException()
@@ -69,12 +71,18 @@ public:
     ConnectionPtr connection;
 
     MessageHandler messageHandler;
+    const Compression compression;
 
     std::unique_ptr<ClientContext> context; // must be destructed first
 };
 
 Client::Client()
-    : _impl(new Impl())
+    : _impl(new Impl(ClientOptions()))
+{
+}
+
+Client::Client(const ClientOptions& options)
+    : _impl(new Impl(options))
 {
 }
 
@@ -111,11 +119,21 @@ void Client::handleBinary(MessageCallback callback)
     _impl->messageHandler.callbackBinary = callback;
 }
 
+void Client::handleBinaryFragments(FragmentCallback callback)
+{
+    _impl->messageHandler.callbackBinaryFragment = callback;
+}
+
 void Client::sendBinary(const char* data, const size_t size)
 {
     _impl->connection->sendBinary({data, size});
 }
 
+void Client::streamBinary(StreamCallback producer)
+{
+    _impl->connection->sendStream(std::move(producer));
+}
+
 void Client::_setSocketListener(SocketListener* listener)
 {
     _impl->pollDescriptors.setListener(listener);
@@ -154,6 +172,11 @@ static int callback_ws(lws* wsi, lws_callback_reasons reason, void* /*user*/,
         auto client = static_cast<Client::Impl*>(protocol->user);
         switch (reason)
         {
+        case LWS_CALLBACK_CLIENT_FILTER_PRE_ESTABLISH: // headers available
+            if (client->connection)
+                client->connection->getChannel().setCompression(
+                    client->compression, true);
+            break;
         case LWS_CALLBACK_CLIENT_ESTABLISHED:
             client->connectionPromise.set_value();
             break;
@@ -170,7 +193,8 @@ static int callback_ws(lws* wsi, lws_callback_reasons reason, void* /*user*/,
                                                  (const char*)in, len);
             break;
         case LWS_CALLBACK_CLIENT_WRITEABLE:
-            client->connection->writeMessages();
+            if (!client->connection->writeMessages())
+                return -1;
             break;
 
         case LWS_CALLBACK_ADD_POLL_FD:
@@ -21,7 +21,7 @@
 #define ROCKETS_WS_CLIENT_H
 
 #include <rockets/socketBasedInterface.h>
-#include <rockets/ws/types.h>
+#include <rockets/ws/clientOptions.h>
 
 namespace rockets
 {
@@ -38,6 +38,14 @@ public:
     /** Construct a new client. */
     ROCKETS_API Client();
 
+    /**
+     * Construct a new client with the given options.
+     *
+     * @param options of the client.
+     * @throw std::invalid_argument if the compression is out of range.
+     */
+    ROCKETS_API explicit Client(const ClientOptions& options);
+
     /** Close the client. */
     ROCKETS_API ~Client();
 
@@ -59,12 +67,24 @@ public:
     /** Send a binary message to the websocket server. */
     ROCKETS_API void sendBinary(const char* data, size_t size);
 
+    /**
+     * Send a large binary message in fragments produced on demand during
+     * process(), until the producer returns 0.
+     */
+    ROCKETS_API void streamBinary(StreamCallback producer);
+
     /** Set a callback for handling text messages from the server. */
     ROCKETS_API void handleText(MessageCallback callback);
 
     /** Set a callback for handling binray messages from the server. */
     ROCKETS_API void handleBinary(MessageCallback callback);
 
+    /**
+     * Set a callback for handling binary messages from the server one
+     * fragment at a time as they arrive, instead of handleBinary().
+     */
+    ROCKETS_API void handleBinaryFragments(FragmentCallback callback);
+
     class Impl; // must be public for static_cast from C callback
 private:
     std::unique_ptr<Impl> _impl;
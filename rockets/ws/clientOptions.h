@@ -0,0 +1,55 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_WS_CLIENTOPTIONS_H
+#define ROCKETS_WS_CLIENTOPTIONS_H
+
+#include <rockets/ws/types.h>
+
+namespace rockets
+{
+namespace ws
+{
+/**
+ * Configuration of a websocket Client.
+ */
+struct ClientOptions
+{
+    /** The compression of messages, if the server supports it. */
+    Compression compression;
+
+    /**
+     * The base-2 logarithm of the largest window the server may compress
+     * with, from 9 to 15, which bounds the memory used to inflate its
+     * messages. Only offered if the compression is enabled.
+     */
+    int serverMaxWindowBits = 15;
+
+    /** The size of the receive buffer, also the largest frame size read. */
+    size_t rxBufferSize = 1024 * 1024;
+
+    /**
+     * The maximum size of a message from the server, 0 for unlimited. The
+     * connection is closed with status 1009 when a message grows larger.
+     */
+    size_t maxMessageSize = 0;
+};
+}
+}
+
+#endif
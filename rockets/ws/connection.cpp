@@ -17,48 +17,256 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+
 #include "connection.h"
 
 #include "channel.h"
 
+#include <algorithm>
+
 namespace rockets
 {
 namespace ws
 {
-Connection::Connection(std::unique_ptr<Channel> channel_)
+namespace
+{
+const size_t fragmentSize = 64 * 1024;
+const int64_t frameRateWindow = 1000000000; // ns
+
+int64_t getTimeNs()
+{
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+        .count();
+}
+}
+
+Connection::Connection(std::unique_ptr<Channel> channel_,
+                       const uintptr_t clientID_)
     : channel{std::move(channel_)}
+    , clientID{clientID_}
 {
 }
 
-void Connection::sendText(std::string message)
+uintptr_t Connection::getClientID() const
 {
-    enqueueText(std::move(message));
-    channel->requestWrite();
+    return clientID;
 }
 
-void Connection::sendBinary(std::string message)
+void Connection::setQueueLimits(const QueueLimits& limits_,
+                                HighWaterCallback highWaterCallback_)
 {
-    enqueueBinary(std::move(message));
-    channel->requestWrite();
+    limits = limits_;
+    highWaterCallback = std::move(highWaterCallback_);
+}
+
+void Connection::sendText(const std::string& message)
+{
+    send(std::make_shared<Payload>(message, Format::text));
+}
+
+void Connection::sendBinary(const std::string& message)
+{
+    send(std::make_shared<Payload>(message, Format::binary));
+}
+
+bool Connection::send(PayloadPtr payload, const OverflowPolicy policy)
+{
+    if (!makeRoom(payload->size(), policy))
+        return false;
+
+    enqueue(std::move(payload));
+    requestWrite();
+    return true;
+}
+
+bool Connection::sendLatest(PayloadPtr payload, const std::string& key,
+                            const OverflowPolicy policy)
+{
+    if (key.empty())
+        return send(std::move(payload), policy);
+
+    if (closing)
+        return false;
+
+    auto& lane = getLane(*payload);
+    if (replace(lane, key, payload))
+        return true;
+
+    if (!send(std::move(payload), policy))
+        return false;
+    lane.messages.back().key = key;
+    lane.keys[key] = lane.frontSequence + lane.messages.size() - 1;
+    return true;
+}
+
+bool Connection::sendFrame(PayloadPtr payload, const std::string& stream)
+{
+    if (closing)
+        return false;
+
+    if (!replace(getBulkLane(), stream, payload))
+    {
+        // a frame is worthless once the next one is produced, never wait
+        if (!sendLatest(std::move(payload), stream,
+                        OverflowPolicy::dropNewest))
+        {
+            ++framesSkipped;
+            return false;
+        }
+        getBulkLane().messages.back().frame = true;
+        return true;
+    }
+    ++framesSkipped;
+    return true;
+}
+
+FrameStats Connection::getFrameStats() const
+{
+    FrameStats stats;
+    stats.sent = framesSent;
+    stats.skipped = framesSkipped;
+    stats.fps = frameRate;
+
+    // the rate is only updated by sent frames, bound it for stalled clients
+    const auto last = lastFrameTime.load();
+    const auto age = getTimeNs() - last;
+    if (last > 0 && age > frameRateWindow)
+        stats.fps = std::min(stats.fps, 1e9 / double(age));
+    return stats;
+}
+
+bool Connection::sendStream(StreamCallback producer,
+                            const OverflowPolicy policy)
+{
+    if (!makeRoom(0, policy))
+        return false;
+
+    ++queuedMessages;
+    getBulkLane().messages.push_back(
+        {nullptr, std::string(), std::move(producer), false});
+    requestWrite();
+    return true;
+}
+
+bool Connection::writeMessages()
+{
+    writeRequested = false; // this is the requested callback
+    // control frames may be interleaved with the fragments of a stream
+    if (pingRequested && !closing && channel->canWrite())
+    {
+        channel->writePing();
+        pingRequested = false;
+    }
+
+    while (!closing && channel->canWrite())
+    {
+        auto lane = getNextLane();
+        if (!lane)
+            break;
+        if (lane->messages.front().stream)
+        {
+            // give the other connections of this thread a chance to write
+            writeFragment(*lane);
+            break;
+        }
+        writeOneMessage(*lane);
+    }
+
+    if (closing)
+    {
+        channel->setCloseReason(closeStatus, closeReason);
+        return false;
+    }
+
+    if (hasMessage() || pingRequested)
+        requestWrite();
+    return true;
+}
+
+void Connection::ping()
+{
+    pingRequested = true;
+    requestWrite();
+}
+
+void Connection::setReceiveEnabled(const bool enabled)
+{
+    channel->setReceiveEnabled(enabled);
+}
+
+void Connection::enqueueText(const std::string& message)
+{
+    enqueue(std::make_shared<Payload>(message, Format::text));
+}
+
+void Connection::enqueueBinary(const std::string& message)
+{
+    enqueue(std::make_shared<Payload>(message, Format::binary));
+}
+
+void Connection::enqueue(PayloadPtr payload)
+{
+    ++queuedMessages;
+    queuedBytes += payload->size();
+    auto& lane = getLane(*payload);
+    lane.messages.push_back(
+        {std::move(payload), std::string(), StreamCallback(), false});
+
+    if (limits.highWaterBytes > 0 && !aboveHighWater &&
+        queuedBytes > limits.highWaterBytes)
+    {
+        aboveHighWater = true;
+        if (highWaterCallback)
+            highWaterCallback(getQueueDepth());
+    }
+}
+
+QueueDepth Connection::getQueueDepth() const
+{
+    QueueDepth depth;
+    depth.messages = queuedMessages;
+    depth.bytes = queuedBytes;
+    return depth;
 }
 
-void Connection::writeMessages()
+bool Connection::isQueueFull(const size_t size) const
 {
-    while (hasMessage() && channel->canWrite())
-        writeOneMessage();
+    const auto messages = queuedMessages.load();
+    if (limits.maxMessages > 0 && messages >= limits.maxMessages)
+        return true;
+    return limits.maxBytes > 0 && messages > 0 &&
+           queuedBytes + size > limits.maxBytes;
+}
 
-    if (hasMessage())
-        channel->requestWrite();
+void Connection::close()
+{
+    closing = true;
+    requestWrite();
 }
 
-void Connection::enqueueText(std::string message)
+void Connection::close(const lws_close_status status, const std::string& reason)
 {
-    out.emplace_back(std::move(message), Format::text);
+    closeStatus = status;
+    closeReason = reason;
+    close();
 }
 
-void Connection::enqueueBinary(std::string message)
+void Connection::abort(const lws_close_status status,
+                       const std::string& reason, const unsigned int timeout)
 {
-    out.emplace_back(std::move(message), Format::binary);
+    close(status, reason);
+    channel->closeAfter(timeout);
+}
+
+bool Connection::isClosing() const
+{
+    return closing;
+}
+
+Channel& Connection::getChannel()
+{
+    return *channel;
 }
 
 const Channel& Connection::getChannel() const
@@ -66,16 +274,189 @@ const Channel& Connection::getChannel() const
     return *channel;
 }
 
+IncomingMessage& Connection::getIncomingMessage()
+{
+    return incoming;
+}
+
+Activity& Connection::getActivity()
+{
+    return activity;
+}
+
+// Arming the writable callback once per callback is enough, however many
+// messages are queued until then.
+void Connection::requestWrite()
+{
+    if (writeRequested)
+        return;
+    writeRequested = true;
+    channel->requestWrite();
+}
+
+Connection::Lane& Connection::getLane(const Payload& payload)
+{
+    return payload.getFormat() == Format::text ? lanes[0] : getBulkLane();
+}
+
+Connection::Lane& Connection::getBulkLane()
+{
+    return lanes[1];
+}
+
+Connection::Lane* Connection::getNextLane()
+{
+    if (streaming)
+        return &getBulkLane();
+    for (auto& lane : lanes)
+    {
+        if (!lane.messages.empty())
+            return &lane;
+    }
+    return nullptr;
+}
+
+// Bulk messages are dropped first, but not a stream which has started
+Connection::Lane* Connection::getDroppableLane()
+{
+    if (!getBulkLane().messages.empty() && !streaming)
+        return &getBulkLane();
+    if (!lanes[0].messages.empty())
+        return &lanes[0];
+    return nullptr;
+}
+
+bool Connection::makeRoom(const size_t size, OverflowPolicy policy)
+{
+    if (closing)
+        return false;
+
+    if (policy == OverflowPolicy::unspecified)
+        policy = limits.policy;
+
+    if (isQueueFull(size))
+    {
+        switch (policy)
+        {
+        case OverflowPolicy::dropNewest:
+            return false;
+        case OverflowPolicy::disconnect:
+            close();
+            return false;
+        case OverflowPolicy::dropOldest:
+            while (isQueueFull(size))
+            {
+                auto lane = getDroppableLane();
+                if (!lane)
+                    break;
+                popMessage(*lane);
+            }
+            break;
+        case OverflowPolicy::block: // the sender already waited for room
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
 bool Connection::hasMessage() const
 {
-    return !out.empty();
+    return !lanes[0].messages.empty() || !lanes[1].messages.empty();
+}
+
+void Connection::writeOneMessage(Lane& lane)
+{
+    const auto& message = lane.messages.front();
+    channel->write(*message.payload, message.payload.use_count() > 1);
+    if (message.frame)
+        countFrame();
+    popMessage(lane);
 }
 
-void Connection::writeOneMessage()
+void Connection::countFrame()
 {
-    auto& message = out.at(0);
-    channel->write(std::move(message.first), message.second);
-    out.pop_front();
+    const auto now = getTimeNs();
+    ++framesSent;
+    lastFrameTime = now;
+    if (frameWindowStart == 0)
+    {
+        frameWindowStart = now; // count the intervals after the first frame
+        return;
+    }
+
+    ++frameWindowCount;
+    const auto elapsed = now - frameWindowStart;
+    if (elapsed >= frameRateWindow)
+    {
+        frameRate = frameWindowCount * 1e9 / double(elapsed);
+        frameWindowStart = now;
+        frameWindowCount = 0;
+    }
+}
+
+void Connection::writeFragment(Lane& lane)
+{
+    if (fragment.empty())
+        fragment.resize(LWS_PRE + fragmentSize);
+    auto data = fragment.data() + LWS_PRE;
+
+    size_t size = 0;
+    try
+    {
+        const auto& producer = lane.messages.front().stream;
+        size = producer(reinterpret_cast<char*>(data), fragmentSize);
+    }
+    catch (...)
+    {
+        // the message can not be completed, the peer would wait forever
+        close(LWS_CLOSE_STATUS_UNEXPECTED_CONDITION, "stream producer failed");
+        return;
+    }
+    size = std::min(size, fragmentSize);
+
+    const bool first = !streaming;
+    const bool last = size == 0;
+    channel->writeFragment(data, size, first, last);
+    streaming = !last;
+    if (last)
+    {
+        std::vector<unsigned char>().swap(fragment);
+        popMessage(lane);
+    }
+}
+
+void Connection::popMessage(Lane& lane)
+{
+    const auto& message = lane.messages.front();
+    if (!message.key.empty())
+    {
+        const auto it = lane.keys.find(message.key);
+        if (it != lane.keys.end() && it->second == lane.frontSequence)
+            lane.keys.erase(it);
+    }
+    --queuedMessages;
+    if (message.payload)
+        queuedBytes -= message.payload->size();
+    lane.messages.pop_front();
+    ++lane.frontSequence;
+
+    if (aboveHighWater && queuedBytes <= limits.highWaterBytes)
+        aboveHighWater = false;
+}
+
+bool Connection::replace(Lane& lane, const std::string& key,
+                         PayloadPtr& payload)
+{
+    const auto it = lane.keys.find(key);
+    if (it == lane.keys.end())
+        return false;
+
+    auto& message = lane.messages.at(it->second - lane.frontSequence);
+    queuedBytes += payload->size();
+    queuedBytes -= message.payload->size();
+    message.payload = std::move(payload);
+    return true;
 }
 }
 }
@@ -20,10 +20,18 @@
 #ifndef ROCKETS_WS_CONNECTION_H
 #define ROCKETS_WS_CONNECTION_H
 
+#include <rockets/ws/payload.h>
 #include <rockets/ws/types.h>
 
+#include <libwebsockets.h>
+
+#include <atomic>
+#include <chrono>
 #include <deque>
+#include <functional>
+#include <map>
 #include <memory>
+#include <vector>
 
 namespace rockets
 {
@@ -31,38 +39,242 @@ namespace ws
 {
 class Channel;
 
+/**
+ * The limits of the outgoing queue of a connection, 0 for unlimited.
+ */
+struct QueueLimits
+{
+    size_t maxMessages = 0;
+    size_t maxBytes = 0;
+    size_t highWaterBytes = 0; // notify when the queue grows above
+    OverflowPolicy policy = OverflowPolicy::dropOldest; // default policy
+};
+
+/**
+ * The incoming message being received on a connection.
+ */
+struct IncomingMessage
+{
+    std::string buffer; // fragments received so far, unless streamed
+    size_t offset = 0;  // of the next fragment in the message
+    bool discard = false; // until the end of a rejected message
+};
+
+/**
+ * The activity of a connection, to detect idle clients and dead peers.
+ */
+struct Activity
+{
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    TimePoint lastReceived; // any frame, including pongs
+    TimePoint lastMessage;  // data frames only
+    TimePoint pingSent;
+    bool awaitingPong = false;
+};
+
 /**
  * A WebSocket connection.
+ *
+ * Outgoing messages are queued in two lanes: text messages, such as JSON-RPC
+ * responses, go to the control lane, binary messages, streams and frames to
+ * the bulk lane. Between two messages the control lane is written first, so
+ * that replies do not wait for bulk data queued earlier. A message which is
+ * partially written is always completed first, as the frames of different
+ * messages can not be interleaved.
+ *
+ * The queue depth can be observed from any thread, all other methods must be
+ * called from the thread servicing the connection.
  */
 class Connection
 {
 public:
-    explicit Connection(std::unique_ptr<Channel> channel);
+    using HighWaterCallback = std::function<void(QueueDepth)>;
+
+    /**
+     * @param channel to read and write messages.
+     * @param clientID to identify the connection in requests, must not be
+     *        reused by other connections of the same Server.
+     */
+    explicit Connection(std::unique_ptr<Channel> channel,
+                        uintptr_t clientID = 0);
+
+    /** @return the ID given to the connection, thread-safe. */
+    uintptr_t getClientID() const;
+
+    /** Limit the outgoing queue, notifying when it grows above high water. */
+    void setQueueLimits(const QueueLimits& limits,
+                        HighWaterCallback highWaterCallback);
 
     /** Send a text message (will be queued for later processing). */
-    void sendText(std::string message);
+    void sendText(const std::string& message);
 
     /** Send a binary message (will be queued for later processing). */
-    void sendBinary(std::string message);
+    void sendBinary(const std::string& message);
+
+    /**
+     * Send a shared payload (will be queued for later processing).
+     *
+     * If the queue is full, the policy decides if the payload is dropped, if
+     * it replaces the oldest messages or if the connection is closed. A
+     * message larger than the limit is still sent if the queue is empty.
+     *
+     * @return false if the payload was dropped.
+     */
+    bool send(PayloadPtr payload,
+              OverflowPolicy policy = OverflowPolicy::unspecified);
+
+    /**
+     * Send a shared payload which replaces the unsent one with the same key,
+     * keeping its place in the queue. Otherwise it is queued like send().
+     *
+     * @return false if the payload was dropped.
+     */
+    bool sendLatest(PayloadPtr payload, const std::string& key,
+                    OverflowPolicy policy = OverflowPolicy::unspecified);
+
+    /**
+     * Send a frame of a stream, e.g. a rendered image, which replaces the
+     * unsent frame of the same stream. The connection thus holds at most one
+     * frame per stream, and slow clients skip frames instead of falling
+     * behind. Frames are skipped rather than queued if the queue is full.
+     *
+     * @param payload the frame.
+     * @param stream the name of the stream, shares the namespace of the keys
+     *        of binary messages.
+     * @return false if the frame was skipped.
+     */
+    bool sendFrame(PayloadPtr payload, const std::string& stream);
+
+    /** @return the statistics of the frames sent, thread-safe. */
+    FrameStats getFrameStats() const;
+
+    /**
+     * Send a binary message in fragments produced on demand, one fragment per
+     * write callback, so that only one fragment is in memory at a time.
+     *
+     * The messages queued after the stream are written once it ends, as data
+     * frames of other messages can not be interleaved with fragments. The
+     * stream counts as one message of size 0 for the queue limits, and is
+     * never dropped once started.
+     *
+     * @return false if the stream was dropped.
+     */
+    bool sendStream(StreamCallback producer,
+                    OverflowPolicy policy = OverflowPolicy::unspecified);
 
-    /** Write all pending messages. */
-    void writeMessages();
+    /**
+     * Write all pending messages, or the next fragment of a stream.
+     *
+     * @return false if the connection must be closed.
+     */
+    bool writeMessages();
+
+    /** Send a ping at the next write callback, before any pending message. */
+    void ping();
+
+    /** Pause or resume reading incoming messages. */
+    void setReceiveEnabled(bool enabled);
 
     /** Enqueue a text message. */
-    void enqueueText(std::string message);
+    void enqueueText(const std::string& message);
 
     /** Enqueue a binary message. */
-    void enqueueBinary(std::string message);
+    void enqueueBinary(const std::string& message);
+
+    /** Enqueue a shared payload, ignoring the queue limits. */
+    void enqueue(PayloadPtr payload);
+
+    /** @return the current depth of the outgoing queue, thread-safe. */
+    QueueDepth getQueueDepth() const;
+
+    /**
+     * @return true if a message of the given size would overflow the queue,
+     *         thread-safe.
+     */
+    bool isQueueFull(size_t size) const;
+
+    /** Close the connection at the next write callback. */
+    void close();
+
+    /** Close the connection at the next write callback with a reason. */
+    void close(lws_close_status status, const std::string& reason);
+
+    /**
+     * Close the connection with a reason, and drop the socket after the given
+     * time even if the close frame can not be written to an unreachable peer.
+     */
+    void abort(lws_close_status status, const std::string& reason,
+               unsigned int timeout);
+
+    /** @return true if the connection is about to be closed, thread-safe. */
+    bool isClosing() const;
 
     /** @internal*. */
+    Channel& getChannel();
     const Channel& getChannel() const;
 
+    /** @internal the reassembly state of the incoming message. */
+    IncomingMessage& getIncomingMessage();
+
+    /** @internal the activity for keepalive and idle timeouts. */
+    Activity& getActivity();
+
 private:
+    struct Message
+    {
+        PayloadPtr payload; // or null for a stream
+        std::string key;
+        StreamCallback stream;
+        bool frame;
+    };
+
+    /** A FIFO queue of messages of one priority. */
+    struct Lane
+    {
+        std::deque<Message> messages;
+        uint64_t frontSequence = 0;           // of messages.front()
+        std::map<std::string, uint64_t> keys; // sequence of unsent keyed ones
+    };
+
     std::unique_ptr<Channel> channel;
-    std::deque<std::pair<std::string, Format>> out;
+    const uintptr_t clientID;
+    IncomingMessage incoming;
+    Activity activity;
+    bool pingRequested = false;
+    bool writeRequested = false; // until the next writable callback
+    Lane lanes[2];                       // control, then bulk
+    std::vector<unsigned char> fragment; // buffer of the stream being sent
+    bool streaming = false; // the front of the bulk lane is partially sent
+
+    QueueLimits limits;
+    HighWaterCallback highWaterCallback;
+    bool aboveHighWater = false;
+    std::atomic<size_t> queuedMessages{0};
+    std::atomic<size_t> queuedBytes{0};
+    std::atomic<bool> closing{false};
+    lws_close_status closeStatus = LWS_CLOSE_STATUS_POLICY_VIOLATION;
+    std::string closeReason{"outgoing queue overflow"};
+
+    std::atomic<uint64_t> framesSent{0};
+    std::atomic<uint64_t> framesSkipped{0};
+    std::atomic<double> frameRate{0.0};
+    std::atomic<int64_t> lastFrameTime{0}; // steady clock nanoseconds
+    int64_t frameWindowStart = 0;
+    uint64_t frameWindowCount = 0;
 
+    void requestWrite();
+    Lane& getLane(const Payload& payload);
+    Lane& getBulkLane();
+    Lane* getNextLane();
+    Lane* getDroppableLane();
+    bool makeRoom(size_t size, OverflowPolicy policy);
     bool hasMessage() const;
-    void writeOneMessage();
+    void writeOneMessage(Lane& lane);
+    void countFrame();
+    void writeFragment(Lane& lane);
+    void popMessage(Lane& lane);
+    bool replace(Lane& lane, const std::string& key, PayloadPtr& payload);
 };
 }
 }
@@ -0,0 +1,76 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "extensions.h"
+
+#include <stdexcept>
+
+namespace rockets
+{
+namespace ws
+{
+namespace
+{
+#if ROCKETS_USE_DEFLATE
+const char* deflateOffer = "permessage-deflate; client_max_window_bits";
+const lws_extension deflateExtensions[] = {
+    {"permessage-deflate", lws_extension_callback_pm_deflate, deflateOffer},
+    {nullptr, nullptr, nullptr}};
+#endif
+
+void _checkRange(const int value, const int min, const int max,
+                 const char* name)
+{
+    if (value < min || value > max)
+        throw std::invalid_argument(std::string("Invalid compression ") +
+                                    name + ": " + std::to_string(value));
+}
+}
+
+const lws_extension* getExtensions(const Compression& compression)
+{
+    if (!compression.enabled)
+        return nullptr;
+
+    _checkRange(compression.level, 1, 9, "level");
+    _checkRange(compression.windowBits, 8, 15, "window bits");
+#if ROCKETS_USE_DEFLATE
+    return deflateExtensions;
+#else
+    throw std::runtime_error("libwebsockets has no support for compression");
+#endif
+}
+
+std::vector<lws_extension> getClientExtensions(const Compression& compression,
+                                               std::string& offer,
+                                               const int serverWindowBits)
+{
+    const auto extensions = getExtensions(compression);
+    if (!extensions)
+        return {};
+
+    // zlib can not compress raw deflate streams with a window of 8 bits
+    _checkRange(serverWindowBits, 9, 15, "server window bits");
+    offer = extensions[0].client_offer;
+    if (serverWindowBits < 15)
+        offer += "; server_max_window_bits=" + std::to_string(serverWindowBits);
+    return {{extensions[0].name, extensions[0].callback, offer.c_str()},
+            {nullptr, nullptr, nullptr}};
+}
+}
+}
@@ -0,0 +1,65 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_WS_EXTENSIONS_H
+#define ROCKETS_WS_EXTENSIONS_H
+
+#include <rockets/ws/types.h>
+
+#include <libwebsockets.h>
+
+#include <string>
+#include <vector>
+
+// lws_set_extension_option() is needed to configure each connection
+#if LWS_LIBRARY_VERSION_NUMBER >= 2000000 && !defined(LWS_WITHOUT_EXTENSIONS)
+#define ROCKETS_USE_DEFLATE 1
+#endif
+
+namespace rockets
+{
+namespace ws
+{
+/**
+ * Get the lws extensions to offer for the given compression settings.
+ *
+ * @return null-terminated extensions, or nullptr if compression is disabled.
+ * @throw std::invalid_argument if the settings are out of range.
+ * @throw std::runtime_error if lws has no support for permessage-deflate.
+ */
+const lws_extension* getExtensions(const Compression& compression);
+
+/**
+ * Get the lws extensions offered by a client, which asks the server to
+ * compress with a window of at most the given size.
+ *
+ * @param compression settings of the client.
+ * @param offer storage for the offered parameters, which must outlive the
+ *        extensions.
+ * @param serverWindowBits the largest window of the server, from 9 to 15.
+ * @return null-terminated extensions, empty if compression is disabled.
+ * @throw std::invalid_argument if the settings are out of range.
+ * @throw std::runtime_error if lws has no support for permessage-deflate.
+ */
+std::vector<lws_extension> getClientExtensions(const Compression& compression,
+                                               std::string& offer,
+                                               int serverWindowBits);
+}
+}
+
+#endif
@@ -28,53 +28,150 @@ namespace rockets
 {
 namespace ws
 {
-Connections MessageHandler::_emptyConnections{};
+MessageHandler::MessageHandler(Dispatcher dispatcher)
+    : _dispatcher(std::move(dispatcher))
+{
+}
 
-MessageHandler::MessageHandler(const Connections& connections)
-    : _connections(connections)
+void MessageHandler::setExecutor(Executor executor)
 {
+    _executor = std::move(executor);
+}
+
+void MessageHandler::setMaxMessageSize(const size_t size)
+{
+    _maxMessageSize = size;
 }
 
 void MessageHandler::handleMessage(ConnectionPtr connection, const char* data,
                                    const size_t len)
 {
-    // compose potentially fragmented message
-    if (connection->getChannel().currentMessageHasMore() && _buffer.empty())
+    const auto& channel = connection->getChannel();
+    const bool final = !channel.currentMessageHasMore();
+    const Format format = channel.getCurrentMessageFormat();
+    if (format == Format::binary && callbackBinaryFragment)
     {
-        _buffer.reserve(
-            len + connection->getChannel().getCurrentMessageRemainingSize());
+        _processFragment(std::move(connection), data, len, final);
+        return;
     }
-    _buffer.append(data, len);
-    if (connection->getChannel().currentMessageHasMore())
+
+    // compose potentially fragmented message, which can be interleaved with
+    // the ones of other connections
+    auto& incoming = connection->getIncomingMessage();
+    auto& buffer = incoming.buffer;
+    if (incoming.discard)
+    {
+        incoming.discard = !final;
+        return;
+    }
+    // reject before buffering, using the known size of the current frame
+    const auto remaining = channel.getCurrentMessageRemainingSize();
+    if (_maxMessageSize > 0 &&
+        buffer.size() + len + remaining > _maxMessageSize)
+    {
+        std::string().swap(buffer);
+        incoming.discard = !final;
+        connection->close(LWS_CLOSE_STATUS_MESSAGE_TOO_LARGE,
+                          "message too large");
         return;
+    }
+    const bool hasView = format == Format::text ? bool(callbackTextView)
+                                                : bool(callbackBinaryView);
+    if (hasView && final && buffer.empty())
+    {
+        // complete in one frame, no need to copy it out of the lws buffer
+        _processView(std::move(connection), data, len, format);
+        return;
+    }
+    if (!final && buffer.empty())
+        buffer.reserve(len + remaining);
+    buffer.append(data, len);
+    if (!final)
+        return;
+
+    if (hasView)
+    {
+        _processView(connection, buffer.data(), buffer.size(), format);
+        std::string().swap(buffer);
+        return;
+    }
+
+    std::string message = std::move(buffer);
+    buffer.clear();
 
-    const auto clientID = reinterpret_cast<uintptr_t>(connection.get());
-    const Format format = connection->getChannel().getCurrentMessageFormat();
+    if (!_executor)
+    {
+        _processMessage(std::move(connection), std::move(message), format,
+                        false);
+        return;
+    }
+    _executor(connection, [this, connection, format,
+                           message = std::move(message)]() mutable {
+        _processMessage(std::move(connection), std::move(message), format,
+                        true);
+    });
+}
+
+void MessageHandler::_processFragment(ConnectionPtr connection,
+                                      const char* data, const size_t len,
+                                      const bool final)
+{
+    auto& incoming = connection->getIncomingMessage();
+    const auto clientID = connection->getClientID();
+    const Fragment fragment{data, len, incoming.offset, final, clientID};
+    incoming.offset = final ? 0 : incoming.offset + len;
+
+    auto response = callbackBinaryFragment(fragment);
+    if (response.format == Format::unspecified)
+        response.format = Format::binary;
+    _sendResponseToRecipient(response, connection);
+}
+
+void MessageHandler::_processView(ConnectionPtr connection, const char* data,
+                                  const size_t len, const Format format)
+{
+    const MessageView view{data, len, connection->getClientID()};
+    auto response = format == Format::text ? callbackTextView(view)
+                                           : callbackBinaryView(view);
+    if (response.format == Format::unspecified)
+        response.format = format;
+    _sendResponseToRecipient(response, connection);
+}
+
+void MessageHandler::_processMessage(ConnectionPtr connection,
+                                     std::string message, const Format format,
+                                     const bool dispatchAll)
+{
+    const auto clientID = connection->getClientID();
     Response response;
     if (format == Format::text)
     {
         if (callbackText)
-            response = callbackText({std::move(_buffer), clientID});
+            response = callbackText({std::move(message), clientID});
         else if (callbackTextAsync)
         {
-            callbackTextAsync({std::move(_buffer), clientID},
-                              [weak = std::weak_ptr<Connection>(connection)](
-                                  const auto& reply) {
+            callbackTextAsync({std::move(message), clientID},
+                              [weak = std::weak_ptr<Connection>(connection),
+                               dispatcher = _dispatcher](const auto& reply) {
                                   auto conn = weak.lock();
-                                  if (conn && !reply.empty())
+                                  if (!conn || reply.empty())
+                                      return;
+                                  if (dispatcher)
+                                      dispatcher({reply, Recipient::sender,
+                                                  Format::text},
+                                                 conn);
+                                  else
                                       conn->sendText(std::move(reply));
                               });
             return;
         }
     }
     else if (format == Format::binary && callbackBinary)
-        response = callbackBinary({std::move(_buffer), clientID});
-
-    _buffer.clear();
+        response = callbackBinary({std::move(message), clientID});
 
     if (response.format == Format::unspecified)
         response.format = format;
-    _sendResponseToRecipient(response, connection);
+    _sendResponseToRecipient(response, connection, dispatchAll);
 }
 
 void MessageHandler::handleOpenConnection(ConnectionPtr connection)
@@ -82,7 +179,7 @@ void MessageHandler::handleOpenConnection(ConnectionPtr connection)
     if (!callbackOpen)
         return;
 
-    const auto clientID = reinterpret_cast<uintptr_t>(connection.get());
+    const auto clientID = connection->getClientID();
     auto responses = callbackOpen(clientID);
     for (auto& response : responses)
         _sendResponseToRecipient(response, connection);
@@ -93,7 +190,7 @@ void MessageHandler::handleCloseConnection(ConnectionPtr connection)
     if (!callbackClose)
         return;
 
-    const auto clientID = reinterpret_cast<uintptr_t>(connection.get());
+    const auto clientID = connection->getClientID();
     auto responses = callbackClose(clientID);
     for (auto& response : responses)
         _sendResponseToRecipient(response, connection);
@@ -115,27 +212,25 @@ void sendResponse(const Response& response, Connection& connection)
 }
 
 void MessageHandler::_sendResponseToRecipient(const Response& response,
-                                              ConnectionPtr sender)
+                                              ConnectionPtr sender,
+                                              const bool dispatchAll)
 {
     if (response.message.empty())
         return;
 
+    if (dispatchAll && _dispatcher)
+    {
+        _dispatcher(response, sender);
+        return;
+    }
+
     switch (response.recipient)
     {
     case Recipient::all:
     case Recipient::others:
-    {
-        for (const auto& connection : _connections)
-        {
-            if (response.recipient == Recipient::others &&
-                connection.second == sender)
-            {
-                continue;
-            }
-            sendResponse(response, *connection.second);
-        }
+        if (_dispatcher)
+            _dispatcher(response, sender);
         break;
-    }
     case Recipient::sender:
     default:
         sendResponse(response, *sender);
@@ -23,6 +23,8 @@
 #include <rockets/ws/types.h>
 
 #include <libwebsockets.h>
+
+#include <functional>
 #include <map>
 
 namespace rockets
@@ -37,8 +39,31 @@ using Connections = std::map<lws*, ConnectionPtr>;
 class MessageHandler
 {
 public:
+    /**
+     * Deliver a response which can not be sent directly by the calling thread:
+     * responses for other recipients than the sender, and asynchronous replies.
+     */
+    using Dispatcher =
+        std::function<void(const Response& response, ConnectionPtr sender)>;
+
+    /**
+     * Run the processing of a complete message outside of the calling service
+     * thread. Responses are then all delivered through the Dispatcher.
+     */
+    using Executor =
+        std::function<void(ConnectionPtr connection, std::function<void()>)>;
+
     MessageHandler() = default;
-    MessageHandler(const Connections& connections);
+    MessageHandler(Dispatcher dispatcher);
+
+    /** Set the executor for the message callbacks, nullptr to remove. */
+    void setExecutor(Executor executor);
+
+    /**
+     * Set the maximum size of reassembled messages, 0 for unlimited. The
+     * connection is closed as soon as a message grows larger.
+     */
+    void setMaxMessageSize(size_t size);
 
     /**
      * Handle a new connection.
@@ -78,13 +103,34 @@ public:
     /** The callback for messages in binary format. */
     MessageCallback callbackBinary;
 
+    /**
+     * The callback for the fragments of binary messages, instead of
+     * callbackBinary. Always called by the service thread, without executor.
+     */
+    FragmentCallback callbackBinaryFragment;
+
+    /**
+     * The callbacks for messages viewed in the receive buffer, instead of
+     * callbackText and callbackBinary. Always called by the service thread,
+     * without executor.
+     */
+    MessageViewCallback callbackTextView;
+    MessageViewCallback callbackBinaryView;
+
 private:
+    void _processFragment(ConnectionPtr connection, const char* data,
+                          size_t len, bool final);
+    void _processView(ConnectionPtr connection, const char* data, size_t len,
+                      Format format);
+    void _processMessage(ConnectionPtr connection, std::string message,
+                         Format format, bool dispatchAll);
     void _sendResponseToRecipient(const Response& response,
-                                  ConnectionPtr connection);
+                                  ConnectionPtr connection,
+                                  bool dispatchAll = false);
 
-    static Connections _emptyConnections;
-    const Connections& _connections{_emptyConnections};
-    std::string _buffer;
+    Dispatcher _dispatcher;
+    Executor _executor;
+    size_t _maxMessageSize = 0;
 };
 }
 }
@@ -0,0 +1,61 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "payload.h"
+
+#include <string.h> // memcpy
+
+namespace rockets
+{
+namespace ws
+{
+Payload::Payload(const char* data_, const size_t size_, const Format format)
+    : _buffer{new unsigned char[LWS_PRE + size_]}
+    , _size{size_}
+    , _format{format}
+{
+    if (_size > 0)
+        memcpy(_buffer.get() + LWS_PRE, data_, _size);
+}
+
+Payload::Payload(const std::string& message, const Format format)
+    : Payload(message.data(), message.size(), format)
+{
+}
+
+const char* Payload::data() const
+{
+    return reinterpret_cast<const char*>(_buffer.get() + LWS_PRE);
+}
+
+size_t Payload::size() const
+{
+    return _size;
+}
+
+Format Payload::getFormat() const
+{
+    return _format;
+}
+
+unsigned char* Payload::getWriteBuffer() const
+{
+    return _buffer.get() + LWS_PRE;
+}
+}
+}
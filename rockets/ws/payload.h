@@ -0,0 +1,67 @@
+/* Copyright (c) 2026, EPFL/Blue Brain Project
+ *
+ * This file is part of Rockets <https://github.com/BlueBrain/Rockets>
+ *
+ * This library is free software; you can redistribute it and/or modify it under
+ * the terms of the GNU Lesser General Public License version 3.0 as published
+ * by the Free Software Foundation.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this library; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef ROCKETS_WS_PAYLOAD_H
+#define ROCKETS_WS_PAYLOAD_H
+
+#include <rockets/ws/types.h>
+
+#include <libwebsockets.h>
+
+#include <memory>
+#include <string>
+
+namespace rockets
+{
+namespace ws
+{
+/**
+ * A websocket message which can be queued on many connections without copy.
+ *
+ * The message is stored once after LWS_PRE bytes of headroom where lws writes
+ * the frame header. It is immutable, except when written by the only
+ * connection holding it: lws writes the header in the headroom, and client
+ * connections mask the message in place.
+ */
+class Payload
+{
+public:
+    Payload(const char* data, size_t size, Format format);
+    Payload(const std::string& message, Format format);
+
+    const char* data() const;
+    size_t size() const;
+    Format getFormat() const;
+
+    /**
+     * @return the buffer to pass to lws_write(), with LWS_PRE headroom, only
+     *         if no other connection holds the payload.
+     */
+    unsigned char* getWriteBuffer() const;
+
+private:
+    std::unique_ptr<unsigned char[]> _buffer;
+    const size_t _size;
+    const Format _format;
+};
+
+using PayloadPtr = std::shared_ptr<const Payload>;
+}
+}
+
+#endif
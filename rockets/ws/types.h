@@ -52,6 +52,69 @@ enum class Recipient
     all
 };
 
+/**
+ * The policies for sending a message to a connection whose queue is full.
+ */
+enum class OverflowPolicy
+{
+    block,      // wait until the recipients have room, not on service threads;
+                // the ones still full after ServerOptions::blockTimeout are
+                // disconnected
+    dropOldest, // drop the oldest unsent messages to make room
+    dropNewest, // drop the new message
+    disconnect, // close the connection
+    unspecified // use the default policy of the server
+};
+
+/**
+ * The outgoing messages queued on a connection.
+ */
+struct QueueDepth
+{
+    size_t messages = 0;
+    size_t bytes = 0;
+};
+
+/**
+ * The frames of a stream sent to a client, to adapt the frame size or rate
+ * to what the client can receive.
+ */
+struct FrameStats
+{
+    uint64_t sent = 0;    // written to the socket
+    uint64_t skipped = 0; // replaced by a newer frame before being sent
+    double fps = 0.0;     // frames sent per second, over the last second
+};
+
+/**
+ * Producer of a binary message sent in fragments, called from the thread
+ * writing the message until it returns 0.
+ *
+ * @param data buffer to fill with the next part of the message.
+ * @param size of the buffer.
+ * @return the number of bytes written to the buffer, 0 at the end.
+ */
+using StreamCallback = std::function<size_t(char* data, size_t size)>;
+
+/**
+ * The permessage-deflate compression of websocket messages (RFC 7692).
+ *
+ * Compression is only used if both peers enable it.
+ */
+struct Compression
+{
+    bool enabled = false;
+
+    /** The zlib compression level, from 1 (fastest) to 9 (smallest). */
+    int level = 1;
+
+    /**
+     * The base-2 logarithm of the deflate window size, from 8 to 15. The
+     * window negotiated by the peer is used instead if it is smaller.
+     */
+    int windowBits = 15;
+};
+
 /**
  * A request from a client during handleText()/handleBinary().
  */
@@ -70,6 +133,13 @@ struct Request
     }
 
     std::string message;
+
+    /**
+     * The ID of the client on the Server, never reused by another client of
+     * the same Server on 64-bit platforms. On 32-bit platforms, only 16 bits
+     * are left for the sequence number, which wraps around after 65536
+     * clients.
+     */
     const uintptr_t clientID;
 };
 
@@ -108,8 +178,46 @@ using MessageCallback = std::function<Response(Request)>;
 /** Callback for handling request with delayed response. */
 using MessageCallbackAsync = std::function<void(Request, ResponseCallback)>;
 
+/**
+ * A part of an incoming message, as received from the network.
+ */
+struct Fragment
+{
+    const char* data;  // only valid during the callback
+    size_t size;
+    size_t offset;     // of the data in the message
+    bool final;        // last fragment of the message
+    uintptr_t clientID;
+};
+
+/**
+ * WebSocket callback for handling the fragments of messages as they arrive.
+ * The response, usually for the final fragment, is sent if not empty.
+ */
+using FragmentCallback = std::function<Response(const Fragment&)>;
+
+/**
+ * A complete incoming message, viewed without copy in the receive buffer of
+ * the connection when it arrived in a single frame.
+ */
+struct MessageView
+{
+    const char* data; // only valid during the callback
+    size_t size;
+    uintptr_t clientID;
+};
+
+/**
+ * WebSocket callback for handling messages without copying them, the response
+ * is sent if not empty.
+ */
+using MessageViewCallback = std::function<Response(const MessageView&)>;
+
 /** Websocket callback for handling connection (open/close) messages. */
 using ConnectionCallback = std::function<std::vector<Response>(uintptr_t)>;
+
+/** Websocket callback for the outgoing queue state of a connection. */
+using QueueCallback = std::function<void(uintptr_t, QueueDepth)>;
 }
 }
 
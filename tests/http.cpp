@@ -33,8 +33,21 @@
 
 #include <libwebsockets.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include <boost/mpl/vector.hpp>
 #include <boost/test/unit_test.hpp>
@@ -152,6 +165,33 @@ public:
 private:
 };
 
+#ifndef _WIN32
+// For requests with headers which the http::Client does not send
+std::string sendRawRequest(const uint16_t port, const std::string& request)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    std::string headers;
+    if (connect(fd, (sockaddr*)&address, sizeof(address)) == 0 &&
+        send(fd, request.data(), request.size(), 0) == ssize_t(request.size()))
+    {
+        char buffer[1024];
+        ssize_t size = 0;
+        while (headers.find("\r\n\r\n") == std::string::npos &&
+               (size = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+        {
+            headers.append(buffer, size_t(size));
+        }
+    }
+    close(fd);
+    return headers;
+}
+#endif
+
 struct ScopedEnvironment
 {
     ScopedEnvironment(const std::string& key, const std::string& value)
@@ -197,6 +237,15 @@ std::ostream& operator<<(std::ostream& oss, const http::Header& header)
     case Header::RETRY_AFTER:
         oss << "Retry-After";
         break;
+    case Header::ETAG:
+        oss << "ETag";
+        break;
+    case Header::CONTENT_ENCODING:
+        oss << "Content-Encoding";
+        break;
+    case Header::VARY:
+        oss << "Vary";
+        break;
     default:
         oss << "UNDEFINED";
         break;
@@ -387,8 +436,435 @@ BOOST_AUTO_TEST_CASE(no_process_with_service_threads)
     BOOST_CHECK_THROW(server.process(100), std::logic_error);
 }
 
+BOOST_AUTO_TEST_CASE(no_worker_threads_without_service_threads)
+{
+    ServerOptions options;
+    options.workerCount = 1;
+    BOOST_CHECK_THROW(Server{options}, std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(pinned_service_threads)
+{
+    ServerOptions options;
+    options.threadCount = 1;
+    options.affinity = {{0}};
+    options.numaLocalMemory = true;
+    Server server{options};
+    BOOST_CHECK_EQUAL(server.getThreadCount(), 1);
+
+    MockClient client;
+    BOOST_CHECK_EQUAL(client.checkGET(server, "/registry").code,
+                      http::Code::OK);
+
+    options.affinity = {{0}, {0}};
+    BOOST_CHECK_THROW(Server{options}, std::invalid_argument);
+}
+
+#if CLIENT_SUPPORTS_REP_ERRORS
+BOOST_AUTO_TEST_CASE(reject_requests_when_worker_queue_is_full)
+{
+    ServerOptions options;
+    options.threadCount = 1;
+    options.workerCount = 1;
+    options.workerQueueSize = 1;
+    options.retryAfter = 5;
+    Server server{options};
+    BOOST_CHECK_EQUAL(server.getWorkerCount(), 1);
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic_bool busy{false};
+    server.handle(http::Method::GET, "slow", [&](const http::Request&) {
+        busy = true;
+        released.wait();
+        return http::make_ready_response(http::Code::OK);
+    });
+
+    // first request occupies the worker, second one fills the queue
+    MockClient client;
+    const auto uri = server.getURI() + "/slow";
+    std::vector<std::future<http::Response>> responses;
+    responses.push_back(client.request(uri));
+    while (!busy)
+        client.process(10);
+    responses.push_back(client.request(uri));
+    responses.push_back(client.request(uri));
+
+    const auto isReady = [](const std::future<http::Response>& response) {
+        return is_ready(response);
+    };
+    while (std::none_of(responses.begin() + 1, responses.end(), isReady))
+        client.process(10);
+    release.set_value();
+    while (!std::all_of(responses.begin(), responses.end(), isReady))
+        client.process(10);
+
+    http::Response error503{http::Code::SERVICE_UNAVAILABLE};
+    error503.headers[http::Header::RETRY_AFTER] = "5";
+    size_t rejected = 0;
+    for (auto& future : responses)
+    {
+        const auto response = future.get();
+        if (response.code == http::Code::SERVICE_UNAVAILABLE)
+        {
+            BOOST_CHECK_EQUAL(response, error503);
+            ++rejected;
+        }
+        else
+            BOOST_CHECK_EQUAL(response, response200);
+    }
+    BOOST_CHECK_EQUAL(rejected, 1);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(destroy_server_with_requests_in_flight)
+{
+    ServerOptions options;
+    options.threadCount = 1;
+    options.workerCount = 2;
+    auto server = std::make_unique<Server>(options);
+
+    std::atomic_int started{0};
+    server->handle(http::Method::GET, "slow", [&](const http::Request&) {
+        ++started;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return http::make_ready_response(http::Code::OK);
+    });
+
+    // both workers are busy and more requests are queued or deferred
+    MockClient client;
+    const auto uri = server->getURI() + "/slow";
+    std::vector<std::future<http::Response>> responses;
+    for (int i = 0; i < 8; ++i)
+        responses.push_back(client.request(uri));
+    while (started < 2)
+        client.process(10);
+
+    server.reset();
+    BOOST_CHECK_LT(started.load(), 8);
+}
+
+BOOST_AUTO_TEST_CASE(pause_requests_when_worker_queue_is_full)
+{
+    ServerOptions options;
+    options.threadCount = 1;
+    options.workerCount = 1;
+    options.workerQueueSize = 1;
+    options.overloadPolicy = OverloadPolicy::pause;
+    Server server{options};
+
+    std::promise<void> release;
+    auto released = release.get_future().share();
+    std::atomic<size_t> calls{0};
+    server.handle(http::Method::GET, "slow", [&](const http::Request&) {
+        ++calls;
+        released.wait();
+        return http::make_ready_response(http::Code::OK);
+    });
+
+    // first request occupies the worker, second one fills the queue, the
+    // reading of the third one is paused instead of rejecting it
+    MockClient client;
+    const auto uri = server.getURI() + "/slow";
+    std::vector<std::future<http::Response>> responses;
+    responses.push_back(client.request(uri));
+    while (calls == 0)
+        client.process(10);
+    responses.push_back(client.request(uri));
+    responses.push_back(client.request(uri));
+
+    const auto isReady = [](const std::future<http::Response>& response) {
+        return is_ready(response);
+    };
+    for (int i = 0; i < 20; ++i)
+        client.process(10);
+    BOOST_CHECK(std::none_of(responses.begin(), responses.end(), isReady));
+    BOOST_CHECK_EQUAL(calls, 1);
+
+    // the paused request resumes once the queue drains
+    release.set_value();
+    while (!std::all_of(responses.begin(), responses.end(), isReady))
+        client.process(10);
+    for (auto& future : responses)
+        BOOST_CHECK_EQUAL(future.get(), response200);
+    BOOST_CHECK_EQUAL(calls, 3);
+}
+
+BOOST_AUTO_TEST_CASE(respond_asynchronously_from_another_thread)
+{
+    Server server{1u};
+    std::promise<http::ResponseCallback> pending;
+    server.handle(http::Method::GET, "slow",
+                  [&](const http::Request&, http::ResponseCallback respond) {
+                      pending.set_value(std::move(respond));
+                  });
+    server.handle(http::Method::GET, "abandoned",
+                  [](const http::Request&, http::ResponseCallback) {});
+
+    MockClient client;
+    auto response = client.request(server.getURI() + "/slow");
+    auto respond = pending.get_future();
+    while (!is_ready(respond))
+        client.process(10);
+    std::thread responder{[callback = respond.get()] {
+        callback(http::Response{http::Code::OK, "done"});
+        callback(http::Response{http::Code::BAD_REQUEST}); // ignored
+    }};
+    while (!is_ready(response))
+        client.process(10);
+    responder.join();
+    BOOST_CHECK_EQUAL(response.get(), http::Response(http::Code::OK, "done"));
+
+#if CLIENT_SUPPORTS_REP_ERRORS
+    BOOST_CHECK_EQUAL(client.checkGET(server, "/abandoned"),
+                      http::Response{http::Code::INTERNAL_SERVER_ERROR});
+#endif
+}
+
+BOOST_AUTO_TEST_CASE(respond_after_server_destruction)
+{
+    http::ResponseCallback respond;
+    {
+        Server server{1u};
+        std::promise<http::ResponseCallback> pending;
+        server.handle(http::Method::GET, "slow",
+                      [&](const http::Request&,
+                          http::ResponseCallback callback) {
+                          pending.set_value(std::move(callback));
+                      });
+
+        MockClient client;
+        auto response = client.request(server.getURI() + "/slow");
+        auto callback = pending.get_future();
+        while (!is_ready(callback))
+            client.process(10);
+        respond = callback.get();
+    }
+    // the notification of the ready response is ignored
+    respond(http::Response{http::Code::OK, "too late"});
+}
+
+#ifndef _WIN32 // POSIX sockets and temporary directories
+BOOST_AUTO_TEST_CASE(serve_directory_with_conditional_requests)
+{
+    char tmp[] = "/tmp/rocketsXXXXXX";
+    BOOST_REQUIRE(mkdtemp(tmp));
+    const std::string directory{tmp};
+    const std::string index(40 * 1024, 'x'); // sent in several parts
+    std::ofstream(directory + "/index.html") << index;
+    std::ofstream(directory + "/app.js") << "main();";
+
+    Server server{1u};
+    BOOST_CHECK(server.serveDirectory("web", directory));
+    MockClient client;
+
+    const auto response = client.checkGET(server, "/web/");
+    BOOST_CHECK_EQUAL(response.code, http::Code::OK);
+    BOOST_CHECK(response.body == index);
+    BOOST_CHECK_EQUAL(response.headers.at(http::Header::CONTENT_TYPE),
+                      "text/html");
+    BOOST_CHECK_EQUAL(response.headers.count(http::Header::LAST_MODIFIED), 1);
+    const auto etag = response.headers.at(http::Header::ETAG);
+    BOOST_CHECK(!etag.empty());
+
+    const auto script = client.checkGET(server, "/web/app.js");
+    BOOST_CHECK_EQUAL(script.body, "main();");
+    BOOST_CHECK_EQUAL(script.headers.at(http::Header::CONTENT_TYPE),
+                      "application/javascript");
+#if CLIENT_SUPPORTS_REP_ERRORS
+    BOOST_CHECK_EQUAL(client.checkGET(server, "/web/missing.html"), error404);
+#endif
+
+    const std::string request =
+        "GET /web/index.html HTTP/1.1\r\nHost: localhost\r\nIf-None-Match: ";
+    const auto notModified =
+        sendRawRequest(server.getPort(), request + etag + "\r\n\r\n");
+    BOOST_CHECK_EQUAL(notModified.substr(0, 12), "HTTP/1.1 304");
+    const auto modified =
+        sendRawRequest(server.getPort(), request + "\"0\"\r\n\r\n");
+    BOOST_CHECK_EQUAL(modified.substr(0, 12), "HTTP/1.1 200");
+
+    // relative to keep the prefix of a reverse proxy
+    auto redirect = sendRawRequest(
+        server.getPort(), "GET /web HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    BOOST_CHECK_EQUAL(redirect.substr(0, 12), "HTTP/1.1 301");
+    std::transform(redirect.begin(), redirect.end(), redirect.begin(),
+                   ::tolower);
+    BOOST_CHECK(redirect.find("\r\nlocation: web/\r\n") != std::string::npos);
+
+    // a leading '/' is ignored, a taken endpoint is not replaced
+    BOOST_CHECK(server.serveDirectory("/static/", directory));
+    BOOST_CHECK_EQUAL(client.checkGET(server, "/static/app.js").body,
+                      "main();");
+    const auto ok = [](const http::Request&) {
+        return http::make_ready_response(http::Code::OK);
+    };
+    BOOST_CHECK(server.handle(http::Method::GET, "taken", ok));
+    BOOST_CHECK(!server.serveDirectory("taken", directory));
+    BOOST_CHECK(server.handle(http::Method::GET, "taken/", ok));
+
+    std::remove((directory + "/index.html").c_str());
+    std::remove((directory + "/app.js").c_str());
+    rmdir(tmp);
+}
+
+BOOST_AUTO_TEST_CASE(serve_directory_files_larger_than_cached_inside_it)
+{
+    char tmp[] = "/tmp/rocketsXXXXXX";
+    BOOST_REQUIRE(mkdtemp(tmp));
+    const std::string directory{tmp};
+    const std::string outside = directory + ".secret";
+    std::ofstream(outside) << "secret";
+    BOOST_REQUIRE_EQUAL(mkdir((directory + "/www").c_str(), 0700), 0);
+    BOOST_REQUIRE_EQUAL(symlink(outside.c_str(),
+                                (directory + "/www/link.txt").c_str()),
+                        0);
+    std::string large(3 * 1024 * 1024, 'x'); // not cached, read in parts
+    for (size_t i = 0; i < large.size(); i += 4096)
+        large[i] = char('a' + i / 4096 % 26);
+    std::ofstream(directory + "/www/large.bin") << large;
+
+    ServerOptions options;
+    options.threadCount = 1;
+    options.fileCacheSize = 1024;
+    Server server{options};
+    BOOST_CHECK(server.serveDirectory("web", directory + "/www"));
+    MockClient client;
+
+    const auto response = client.checkGET(server, "/web/large.bin");
+    BOOST_CHECK_EQUAL(response.code, http::Code::OK);
+    BOOST_CHECK(response.body == large);
+#if CLIENT_SUPPORTS_REP_ERRORS
+    BOOST_CHECK_EQUAL(client.checkGET(server, "/web/link.txt"), error404);
+#endif
+    const auto escaped = sendRawRequest(
+        server.getPort(),
+        "GET /web/link.txt HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    BOOST_CHECK_EQUAL(escaped.substr(0, 12), "HTTP/1.1 404");
+
+    std::remove((directory + "/www/large.bin").c_str());
+    std::remove((directory + "/www/link.txt").c_str());
+    rmdir((directory + "/www").c_str());
+    rmdir(tmp);
+    std::remove(outside.c_str());
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(compress_responses_for_accepting_clients)
+{
+    ServerOptions options;
+    options.threadCount = 1;
+    options.httpCompression.enabled = true;
+    options.httpCompression.minSize = 100;
+    Server server{options};
+
+    std::string json = "[";
+    for (size_t i = 0; i < 1000; ++i)
+        json.append(std::to_string(i % 10) + ",");
+    json.back() = ']';
+    server.handle(http::Method::GET, "data", [&json](const http::Request&) {
+        return http::make_ready_response(http::Code::OK, json, JSON_TYPE);
+    });
+
+    // the http::Client does not accept compressed responses
+    MockClient client;
+    const auto response = client.checkGET(server, "/data");
+    BOOST_CHECK_EQUAL(response.body, json);
+    BOOST_CHECK_EQUAL(response.headers.count(http::Header::CONTENT_ENCODING),
+                      0);
+    BOOST_CHECK_EQUAL(response.headers.at(http::Header::VARY),
+                      "Accept-Encoding");
+
+#ifndef _WIN32
+    for (size_t i = 0; i < 2; ++i) // the second one is cached
+    {
+        auto headers = sendRawRequest(server.getPort(),
+                                      "GET /data HTTP/1.1\r\n"
+                                      "Host: localhost\r\n"
+                                      "Accept-Encoding: deflate, gzip\r\n\r\n");
+        std::transform(headers.begin(), headers.end(), headers.begin(),
+                       ::tolower);
+        BOOST_CHECK(headers.find("content-encoding: gzip") !=
+                    std::string::npos);
+        BOOST_CHECK(headers.find("vary: accept-encoding") != std::string::npos);
+        const auto length = headers.find("content-length: ");
+        BOOST_REQUIRE(length != std::string::npos);
+        BOOST_CHECK_LT(std::stoul(headers.substr(length + 16)), json.size());
+    }
+#endif
+}
+
+#ifndef _WIN32
+BOOST_AUTO_TEST_CASE(compress_served_files)
+{
+    char tmp[] = "/tmp/rocketsXXXXXX";
+    BOOST_REQUIRE(mkdtemp(tmp));
+    const std::string directory{tmp};
+    std::string script;
+    for (size_t i = 0; i < 1000; ++i)
+        script.append("draw(" + std::to_string(i % 10) + ");\n");
+    std::ofstream(directory + "/app.js") << script;
+
+    ServerOptions options;
+    options.threadCount = 1;
+    options.httpCompression.enabled = true;
+    Server server{options};
+    BOOST_CHECK(server.serveDirectory("web", directory));
+
+    const auto response = sendRawRequest(server.getPort(),
+                                         "GET /web/app.js HTTP/1.1\r\n"
+                                         "Host: localhost\r\n"
+                                         "Accept-Encoding: gzip\r\n\r\n");
+    auto headers = response;
+    std::transform(headers.begin(), headers.end(), headers.begin(), ::tolower);
+    BOOST_CHECK_EQUAL(headers.substr(0, 12), "http/1.1 200");
+    BOOST_CHECK(headers.find("content-encoding: gzip") != std::string::npos);
+    BOOST_CHECK(headers.find("vary: accept-encoding") != std::string::npos);
+    const auto length = headers.find("content-length: ");
+    BOOST_REQUIRE(length != std::string::npos);
+    BOOST_CHECK_LT(std::stoul(headers.substr(length + 16)), script.size());
+
+    // the gzip representation has a weak validator
+    const auto etag = headers.find("etag: w/\"");
+    BOOST_REQUIRE(etag != std::string::npos);
+    const auto tag = response.substr(etag + 6, headers.find('\r', etag) -
+                                                   etag - 6);
+    const auto notModified =
+        sendRawRequest(server.getPort(),
+                       "GET /web/app.js HTTP/1.1\r\nHost: localhost\r\n"
+                       "Accept-Encoding: gzip\r\nIf-None-Match: " +
+                           tag + "\r\n\r\n");
+    BOOST_CHECK_EQUAL(notModified.substr(0, 12), "HTTP/1.1 304");
+
+    std::remove((directory + "/app.js").c_str());
+    rmdir(tmp);
+}
+#endif
+
 #if CLIENT_SUPPORTS_REQ_PAYLOAD
 
+#if CLIENT_SUPPORTS_REP_ERRORS
+BOOST_AUTO_TEST_CASE(reject_request_body_larger_than_max_body_size)
+{
+    ServerOptions options;
+    options.maxBodySize = 16;
+    Server server{options};
+    size_t handled = 0;
+    server.handle(http::Method::POST, "upload", [&](const http::Request&) {
+        ++handled;
+        return http::make_ready_response(http::Code::OK);
+    });
+
+    MockClient client;
+    BOOST_CHECK_EQUAL(client.checkPOST(server, "/upload", std::string(16, 'a')),
+                      response200);
+    const http::Response error413{http::Code::PAYLOAD_TOO_LARGE};
+    BOOST_CHECK_EQUAL(client.checkPOST(server, "/upload", std::string(17, 'a')),
+                      error413);
+    BOOST_CHECK_EQUAL(handled, 1);
+}
+#endif
+
 BOOST_FIXTURE_TEST_CASE_TEMPLATE(get_object_json, F, Fixtures, F)
 {
     F::server.handleGET(F::foo.getEndpoint(), F::foo);
@@ -641,6 +1117,67 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(handle_path, F, Fixtures, F)
     BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/api/size"), response200);
 }
 
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(handle_path_parameters, F, Fixtures, F)
+{
+    const auto paramsFunc = [](const http::Request& request) {
+        std::string body;
+        for (const auto& param : request.params)
+            body.append(param.first + "=" + param.second + ";");
+        return http::make_ready_response(http::Code::OK, body + request.path);
+    };
+    const auto get = http::Method::GET;
+    F::server.handle(get, "users/{id}", paramsFunc);
+    F::server.handle(get, "users/{id}/posts/{post}/", paramsFunc);
+    F::server.handle(get, "users/me", echoFunc);
+
+    BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/users/42"),
+                      http::Response(http::Code::OK, "id=42;"));
+    BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/users/42/posts/7/x"),
+                      http::Response(http::Code::OK, "id=42;post=7;x"));
+    // fixed segments are preferred over parameters
+    BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/users/me"), response200);
+    BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/users/42/posts"),
+                      error404);
+
+    // the longest endpoint which matches is used
+    F::server.handle(get, "api/", echoFunc);
+    F::server.handle(get, "api/v", echoFunc);
+    BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/api/vx"),
+                      http::Response(http::Code::OK, "vx"));
+
+    BOOST_CHECK_THROW(F::server.handle(get, "users/{name}/", echoFunc),
+                      std::invalid_argument);
+    BOOST_CHECK_THROW(F::server.handle(get, "files/{name}.json", echoFunc),
+                      std::invalid_argument);
+}
+
+BOOST_FIXTURE_TEST_CASE_TEMPLATE(handle_chunked_response, F, Fixtures, F)
+{
+    const size_t bodySize = 100 * 1024;
+    size_t calls = 0;
+    F::server.handle(http::Method::GET, "export", [&](const http::Request&) {
+        auto produced = std::make_shared<size_t>(0);
+        http::Response response{http::Code::OK};
+        response.producer = [&, produced](char* data, const size_t size) {
+            ++calls;
+            const auto count = std::min(size, bodySize - *produced);
+            for (size_t i = 0; i < count; ++i)
+                data[i] = 'a' + (*produced + i) % 26;
+            *produced += count;
+            return count;
+        };
+        return http::make_ready_response(std::move(response));
+    });
+
+    std::string expected;
+    for (size_t i = 0; i < bodySize; ++i)
+        expected.push_back('a' + i % 26);
+    BOOST_CHECK_EQUAL(F::client.checkGET(F::server, "/export"),
+                      http::Response(http::Code::OK, expected));
+    // the body was produced in bounded chunks, plus the terminating call
+    BOOST_CHECK_GT(calls, 2);
+}
+
 BOOST_FIXTURE_TEST_CASE_TEMPLATE(handle_headers, F, Fixtures, F)
 {
     const std::string allow = "GET, POST, PUT, PATCH, DELETE";
@@ -23,7 +23,10 @@
 #include <rockets/server.h>
 #include <rockets/ws/client.h>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 
 #include <boost/mpl/vector.hpp>
 #include <boost/test/unit_test.hpp>
@@ -567,3 +570,796 @@ BOOST_FIXTURE_TEST_CASE_TEMPLATE(text_binary_exchange_with_unhandled_text, F,
     F::server.broadcastBinary("hello", 5);
     F::processAllClients(F::server);
 }
+
+BOOST_AUTO_TEST_CASE(server_broadcast_latency_with_service_threads)
+{
+    // Broadcasts used to wait for the next service loop iteration (up to
+    // 50 ms); service threads are now woken up as soon as a message is posted.
+    Server server{"", wsProtocol, 2u};
+    ws::Client client;
+    std::atomic<bool> received{false};
+    client.handleText([&](const ws::Request&) {
+        received = true;
+        return "";
+    });
+    connect(client, server);
+
+    using Clock = std::chrono::high_resolution_clock;
+    std::vector<Clock::duration> latencies;
+    for (int i = 0; i < 100; ++i)
+    {
+        received = false;
+        const auto start = Clock::now();
+        server.broadcastText("ping");
+        while (!received)
+            client.process(1);
+        latencies.push_back(Clock::now() - start);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    const auto p99 = latencies[latencies.size() * 99 / 100];
+    using ms = std::chrono::duration<double, std::milli>;
+    BOOST_CHECK_LT(std::chrono::duration_cast<ms>(p99).count(), 20.0);
+}
+
+#if LWS_LIBRARY_VERSION_NUMBER >= 3000000
+BOOST_AUTO_TEST_CASE(server_broadcast_to_all_contexts)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.threadCount = 1;
+    options.contextCount = 2;
+    Server server{options};
+    BOOST_CHECK_EQUAL(server.getThreadCount(), 2);
+
+    const size_t clientCount = 8;
+    std::vector<std::unique_ptr<ws::Client>> clients;
+    std::atomic<size_t> received{0};
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        clients.emplace_back(new ws::Client);
+        clients.back()->handleText([&](const ws::Request& request) {
+            if (request.message == "hello")
+                ++received;
+            return "";
+        });
+        connect(*clients.back(), server);
+    }
+    while (server.getConnectionCount() < clientCount)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    server.broadcastText("hello");
+    for (int i = 0; i < 100 && received < clientCount; ++i)
+    {
+        for (auto& client : clients)
+            client->process(5);
+    }
+    BOOST_CHECK_EQUAL(received, clientCount);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(server_broadcast_large_binary_to_many_clients)
+{
+    Server server{"", wsProtocol, 2u};
+    std::string message(4 * 1024 * 1024 + 1, '\0');
+    for (size_t i = 0; i < message.size(); ++i)
+        message[i] = static_cast<char>(i % 251);
+
+    const size_t clientCount = 4;
+    std::vector<std::unique_ptr<ws::Client>> clients;
+    std::atomic<size_t> received{0};
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        clients.emplace_back(new ws::Client);
+        clients.back()->handleBinary([&](const ws::Request& request) {
+            if (request.message == message)
+                ++received;
+            return "";
+        });
+        connect(*clients.back(), server);
+    }
+    while (server.getConnectionCount() < clientCount)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    server.broadcastBinary(message.data(), message.size());
+    for (int i = 0; i < 1000 && received < clientCount; ++i)
+    {
+        for (auto& client : clients)
+            client->process(5);
+    }
+    BOOST_CHECK_EQUAL(received, clientCount);
+}
+
+BOOST_AUTO_TEST_CASE(server_callbacks_can_use_the_server)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.threadCount = 2;
+    Server server{options};
+
+    // the callbacks run without any lock held, they may call the server
+    std::atomic<size_t> countOnOpen{0};
+    server.handleOpen([&](const uintptr_t clientID) {
+        countOnOpen = server.getConnectionCount();
+        server.sendText("welcome", clientID);
+        return std::vector<ws::Response>{};
+    });
+    server.handleText([&](const ws::Request& request) {
+        server.broadcastText("echo " + request.message);
+        return "";
+    });
+
+    // clients come and go while another thread broadcasts to them
+    std::atomic_bool done{false};
+    std::thread broadcaster{[&] {
+        while (!done)
+        {
+            server.broadcastText("tick");
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }};
+
+    ws::Client client;
+    std::vector<std::string> received;
+    client.handleText([&](const ws::Request& request) {
+        if (request.message != "tick")
+            received.push_back(request.message);
+        return "";
+    });
+    connect(client, server);
+    for (int i = 0; i < 10; ++i)
+    {
+        ws::Client other;
+        connect(other, server);
+    }
+    client.sendText("hello");
+    for (int i = 0; i < 500 && received.size() < 2; ++i)
+        client.process(10);
+    done = true;
+    broadcaster.join();
+
+    BOOST_CHECK_GE(countOnOpen, 2);
+    BOOST_REQUIRE_EQUAL(received.size(), 2);
+    BOOST_CHECK_EQUAL(received[0], "welcome");
+    BOOST_CHECK_EQUAL(received[1], "echo hello");
+}
+
+BOOST_AUTO_TEST_CASE(server_delivers_all_messages_of_a_burst)
+{
+    Server server{"", wsProtocol, 2u};
+    std::vector<uintptr_t> clientIDs;
+    std::mutex mutex;
+    server.handleOpen([&](const uintptr_t clientID) {
+        std::lock_guard<std::mutex> lock{mutex};
+        clientIDs.push_back(clientID);
+        return std::vector<ws::Response>{};
+    });
+
+    const size_t clientCount = 3;
+    std::vector<std::unique_ptr<ws::Client>> clients;
+    std::vector<std::vector<std::string>> received(clientCount);
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        clients.emplace_back(new ws::Client);
+        clients.back()->handleText([&received, i](const ws::Request& request) {
+            received[i].push_back(request.message);
+            return "";
+        });
+        connect(*clients.back(), server);
+    }
+    while (server.getConnectionCount() < clientCount)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // the wakeups and writable callbacks of a burst are coalesced, which
+    // must not lose any message
+    const size_t count = 1000;
+    uintptr_t first;
+    {
+        std::lock_guard<std::mutex> lock{mutex};
+        first = clientIDs.front();
+    }
+    for (size_t i = 0; i < count; ++i)
+    {
+        server.broadcastText(std::to_string(i));
+        server.sendText("to first", first);
+    }
+
+    const auto isComplete = [&] {
+        for (size_t i = 0; i < clientCount; ++i)
+        {
+            if (received[i].size() < (i == 0 ? 2 * count : count))
+                return false;
+        }
+        return true;
+    };
+    for (int i = 0; i < 1000 && !isComplete(); ++i)
+    {
+        for (auto& client : clients)
+            client->process(5);
+    }
+
+    // clients connect in order, so the first one got the sent messages
+    BOOST_REQUIRE(isComplete());
+    for (size_t i = 0; i < clientCount; ++i)
+    {
+        std::vector<std::string> broadcasts;
+        for (const auto& message : received[i])
+        {
+            if (message != "to first")
+                broadcasts.push_back(message);
+        }
+        BOOST_REQUIRE_EQUAL(broadcasts.size(), count);
+        for (size_t j = 0; j < count; ++j)
+            BOOST_CHECK_EQUAL(broadcasts[j], std::to_string(j));
+        BOOST_CHECK_EQUAL(received[i].size() - broadcasts.size(),
+                          i == 0 ? count : 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(server_disconnects_slow_client_when_queue_is_full)
+{
+    const size_t megabyte = 1024 * 1024;
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.threadCount = 1;
+    options.maxQueueBytes = 8 * megabyte;
+    options.queueHighWaterBytes = 4 * megabyte;
+    options.overflowPolicy = ws::OverflowPolicy::disconnect;
+    Server server{options};
+
+    std::atomic<bool> highWater{false};
+    server.handleQueueHighWater([&](uintptr_t, const ws::QueueDepth depth) {
+        highWater = depth.bytes > options.queueHighWaterBytes;
+    });
+    BOOST_CHECK_EQUAL(server.getQueueDepth(0).messages, 0);
+
+    ws::Client client;
+    connect(client, server);
+    while (server.getConnectionCount() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // the client does not process its messages, so they accumulate on the
+    // server once the socket buffers are full
+    const std::string message(megabyte, 'a');
+    for (int i = 0; i < 64 && server.getConnectionCount() > 0; ++i)
+    {
+        server.broadcastText(message);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    for (int i = 0; i < 1000 && server.getConnectionCount() > 0; ++i)
+        client.process(10);
+
+    BOOST_CHECK(highWater);
+    BOOST_CHECK_EQUAL(server.getConnectionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(server_blocked_send_disconnects_after_timeout)
+{
+    const size_t megabyte = 1024 * 1024;
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.threadCount = 1;
+    options.maxQueueBytes = 4 * megabyte;
+    options.overflowPolicy = ws::OverflowPolicy::block;
+    options.blockTimeout = std::chrono::milliseconds(100);
+    Server server{options};
+
+    ws::Client client;
+    connect(client, server);
+    while (server.getConnectionCount() == 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // the client never reads, so a send eventually blocks until the timeout
+    const std::string message(megabyte, 'a');
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 64 && server.getConnectionCount() > 0; ++i)
+        server.broadcastText(message);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    for (int i = 0; i < 1000 && server.getConnectionCount() > 0; ++i)
+        client.process(10);
+
+    BOOST_CHECK(elapsed >= options.blockTimeout);
+    BOOST_CHECK(elapsed < std::chrono::seconds(5));
+    BOOST_CHECK_EQUAL(server.getConnectionCount(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(server_broadcast_latest_value_per_key)
+{
+    Server server{"", wsProtocol};
+    ws::Client client;
+    std::vector<std::string> received;
+    client.handleText([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return "";
+    });
+    connect(client, server);
+
+    // without service threads, messages are only written by server.process()
+    server.broadcastLatest("camera", "1");
+    server.broadcastText("other");
+    server.broadcastLatest("camera", "2");
+    server.broadcastLatest("camera", "3");
+
+    for (int i = 0; i < 100 && received.size() < 2; ++i)
+    {
+        server.process(10);
+        client.process(10);
+    }
+    const std::vector<std::string> expected{"3", "other"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+                                  expected.begin(), expected.end());
+}
+
+BOOST_AUTO_TEST_CASE(server_publish_only_to_topic_subscribers)
+{
+    Server server{"", wsProtocol};
+    std::vector<uintptr_t> clientIDs;
+    server.handleOpen([&](const uintptr_t clientID) {
+        clientIDs.push_back(clientID);
+        return std::vector<ws::Response>{};
+    });
+
+    ws::Client subscriber;
+    ws::Client other;
+    std::vector<std::string> received;
+    std::vector<std::string> receivedOther;
+    subscriber.handleText([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return "";
+    });
+    other.handleText([&](const ws::Request& request) {
+        receivedOther.push_back(request.message);
+        return "";
+    });
+    connect(subscriber, server);
+    connect(other, server);
+    BOOST_REQUIRE_EQUAL(clientIDs.size(), 2);
+
+    BOOST_CHECK(server.subscribe(clientIDs[0], "camera"));
+    BOOST_CHECK(!server.subscribe(0, "camera"));
+    server.publish("camera", "moved");
+    server.publish("nobody", "ignored");
+    server.broadcastText("everyone");
+
+    for (int i = 0; i < 100 && (received.size() < 2 || receivedOther.empty());
+         ++i)
+    {
+        server.process(10);
+        subscriber.process(10);
+        other.process(10);
+    }
+    const std::vector<std::string> expected{"moved", "everyone"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+                                  expected.begin(), expected.end());
+    BOOST_REQUIRE_EQUAL(receivedOther.size(), 1);
+    BOOST_CHECK_EQUAL(receivedOther[0], "everyone");
+
+    BOOST_CHECK(server.unsubscribe(clientIDs[0], "camera"));
+    server.publish("camera", "moved again");
+    server.broadcastText("done");
+    for (int i = 0; i < 100 && received.size() < 3; ++i)
+    {
+        server.process(10);
+        subscriber.process(10);
+    }
+    BOOST_REQUIRE_EQUAL(received.size(), 3);
+    BOOST_CHECK_EQUAL(received[2], "done");
+}
+
+#if LWS_LIBRARY_VERSION_NUMBER >= 2000000 && !defined(LWS_WITHOUT_EXTENSIONS)
+BOOST_AUTO_TEST_CASE(server_sends_compressed_messages)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.compression.enabled = true;
+    options.compression.level = 9;
+    options.compression.windowBits = 10;
+    Server server{options};
+
+    ws::ClientOptions clientOptions;
+    clientOptions.compression = options.compression;
+    ws::Client client{clientOptions};
+    std::vector<std::string> received;
+    client.handleText([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return "";
+    });
+    connect(client, server);
+
+    std::string large;
+    for (int i = 0; i < 1000; ++i)
+        large += "{\"jsonrpc\": \"2.0\", \"method\": \"progress\"}\n";
+    server.broadcastText("small");
+    server.broadcastText(large);
+    server.broadcastText("small again");
+
+    for (int i = 0; i < 100 && received.size() < 3; ++i)
+    {
+        server.process(10);
+        client.process(10);
+    }
+    const std::vector<std::string> expected{"small", large, "small again"};
+    BOOST_CHECK(received == expected);
+}
+
+BOOST_AUTO_TEST_CASE(server_compresses_within_the_window_of_the_client)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.compression.enabled = true;
+    Server server{options};
+
+    ws::ClientOptions clientOptions;
+    clientOptions.compression.enabled = true;
+    clientOptions.serverMaxWindowBits = 9;
+    ws::Client client{clientOptions};
+    std::vector<std::string> received;
+    client.handleText([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return "";
+    });
+    connect(client, server);
+
+    // the repetition is only found with a window larger than the client's
+    std::string block;
+    unsigned int seed = 42;
+    for (int i = 0; i < 4000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        block += char('a' + (seed >> 16) % 26);
+    }
+    const auto message = block + block;
+    server.broadcastText(message);
+    server.broadcastText(message);
+
+    for (int i = 0; i < 100 && received.size() < 2; ++i)
+    {
+        server.process(10);
+        client.process(10);
+    }
+    BOOST_CHECK_EQUAL(server.getConnectionCount(), 1);
+    const std::vector<std::string> expected{message, message};
+    BOOST_CHECK(received == expected);
+}
+#endif
+
+BOOST_AUTO_TEST_CASE(invalid_compression_settings_throw)
+{
+    ws::ClientOptions options;
+    options.compression.enabled = true;
+    options.compression.level = 10;
+    BOOST_CHECK_THROW(ws::Client{options}, std::invalid_argument);
+
+    options.compression.level = 1;
+    options.serverMaxWindowBits = 8;
+    BOOST_CHECK_THROW(ws::Client{options}, std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(server_streams_large_binary_in_fragments)
+{
+    Server server{"", wsProtocol};
+    uintptr_t clientID = 0;
+    server.handleOpen([&](const uintptr_t id) {
+        clientID = id;
+        return std::vector<ws::Response>{};
+    });
+
+    ws::Client client;
+    std::vector<std::string> received;
+    std::string binary;
+    client.handleText([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return "";
+    });
+    client.handleBinary([&](const ws::Request& request) {
+        binary = request.message;
+        received.push_back("binary");
+        return "";
+    });
+    connect(client, server);
+    BOOST_REQUIRE(clientID != 0);
+
+    const size_t size = 1024 * 1024 + 7;
+    size_t produced = 0;
+    server.streamBinary(
+        [&produced, size](char* data, const size_t maxSize) {
+            const auto count = std::min(maxSize, size - produced);
+            for (size_t i = 0; i < count; ++i)
+                data[i] = static_cast<char>((produced + i) % 251);
+            produced += count;
+            return count;
+        },
+        clientID);
+    // text messages only overtake streams which have not started yet
+    for (int i = 0; i < 100 && produced == 0; ++i)
+        server.process(5);
+    BOOST_REQUIRE(produced > 0);
+    server.sendText("after", clientID);
+
+    for (int i = 0; i < 1000 && received.size() < 2; ++i)
+    {
+        server.process(5);
+        client.process(5);
+    }
+    const std::vector<std::string> expected{"binary", "after"};
+    BOOST_CHECK_EQUAL_COLLECTIONS(received.begin(), received.end(),
+                                  expected.begin(), expected.end());
+    BOOST_REQUIRE_EQUAL(binary.size(), size);
+    bool valid = true;
+    for (size_t i = 0; i < size; ++i)
+        valid = valid && binary[i] == static_cast<char>(i % 251);
+    BOOST_CHECK(valid);
+}
+
+namespace
+{
+ws::StreamCallback makeStream(const size_t size, const char value)
+{
+    auto produced = std::make_shared<size_t>(0);
+    return [produced, size, value](char* data, const size_t maxSize) {
+        const auto count = std::min(maxSize, size - *produced);
+        std::fill(data, data + count, value);
+        *produced += count;
+        return count;
+    };
+}
+}
+
+BOOST_AUTO_TEST_CASE(server_reassembles_interleaved_fragments_per_connection)
+{
+    Server server{"", wsProtocol};
+    std::vector<std::string> received;
+    server.handleBinary([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return ws::Response{};
+    });
+
+    ws::Client client1;
+    ws::Client client2;
+    connect(client1, server);
+    connect(client2, server);
+
+    const size_t size = 512 * 1024;
+    client1.streamBinary(makeStream(size, 'a'));
+    client2.streamBinary(makeStream(size, 'b'));
+    for (int i = 0; i < 1000 && received.size() < 2; ++i)
+    {
+        client1.process(1);
+        client2.process(1);
+        server.process(1);
+    }
+    BOOST_REQUIRE_EQUAL(received.size(), 2);
+    std::sort(received.begin(), received.end());
+    BOOST_CHECK(received[0] == std::string(size, 'a'));
+    BOOST_CHECK(received[1] == std::string(size, 'b'));
+}
+
+BOOST_AUTO_TEST_CASE(server_receives_binary_fragments_as_they_arrive)
+{
+    Server server{"", wsProtocol};
+    size_t fragments = 0;
+    size_t total = 0;
+    bool ordered = true;
+    server.handleBinaryFragments([&](const ws::Fragment& fragment) {
+        ++fragments;
+        ordered = ordered && fragment.offset == total &&
+                  std::all_of(fragment.data, fragment.data + fragment.size,
+                              [](const char c) { return c == 'x'; });
+        total += fragment.size;
+        if (!fragment.final)
+            return ws::Response{};
+        return ws::Response{std::to_string(total), ws::Recipient::sender,
+                            ws::Format::text};
+    });
+
+    ws::Client client;
+    std::string reply;
+    client.handleText([&](const ws::Request& request) {
+        reply = request.message;
+        return "";
+    });
+    connect(client, server);
+
+    const size_t size = 1024 * 1024;
+    client.streamBinary(makeStream(size, 'x'));
+    for (int i = 0; i < 1000 && reply.empty(); ++i)
+    {
+        client.process(1);
+        server.process(1);
+    }
+    BOOST_CHECK_EQUAL(reply, std::to_string(size));
+    BOOST_CHECK(ordered);
+    BOOST_CHECK_GT(fragments, 1);
+}
+
+BOOST_AUTO_TEST_CASE(server_disconnects_client_sending_too_large_message)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.maxMessageSize = 1024;
+    Server server{options};
+    std::vector<std::string> received;
+    server.handleText([&](const ws::Request& request) {
+        received.push_back(request.message);
+        return "";
+    });
+
+    ws::Client client;
+    connect(client, server);
+    client.sendText(std::string(1024, 'a'));
+    client.sendText(std::string(1025, 'b'));
+    for (int i = 0; i < 100 && server.getConnectionCount() > 0; ++i)
+    {
+        client.process(10);
+        server.process(10);
+    }
+    BOOST_CHECK_EQUAL(server.getConnectionCount(), 0);
+    BOOST_REQUIRE_EQUAL(received.size(), 1);
+    BOOST_CHECK_EQUAL(received[0].size(), 1024);
+}
+
+BOOST_AUTO_TEST_CASE(client_ids_are_not_reused_after_disconnect)
+{
+    Server server{"", wsProtocol};
+    std::vector<uintptr_t> clientIDs;
+    server.handleOpen([&](const uintptr_t clientID) {
+        clientIDs.push_back(clientID);
+        return std::vector<ws::Response>{};
+    });
+
+    for (int i = 0; i < 2; ++i)
+    {
+        ws::Client client;
+        connect(client, server);
+    }
+    for (int i = 0; i < 100 && server.getConnectionCount() > 0; ++i)
+        server.process(10);
+    BOOST_REQUIRE_EQUAL(clientIDs.size(), 2);
+    BOOST_CHECK_NE(clientIDs[0], clientIDs[1]);
+
+    // messages to a disconnected client are dropped, not misdelivered
+    ws::Client client;
+    bool received = false;
+    client.handleText([&](const ws::Request&) {
+        received = true;
+        return "";
+    });
+    connect(client, server);
+    BOOST_REQUIRE_EQUAL(clientIDs.size(), 3);
+    server.sendText("hello", clientIDs[0]);
+    server.sendText("hello", 12345);
+    for (int i = 0; i < 10; ++i)
+    {
+        server.process(10);
+        client.process(10);
+    }
+    BOOST_CHECK(!received);
+    BOOST_CHECK(!server.subscribe(clientIDs[1], "topic"));
+    BOOST_CHECK(server.subscribe(clientIDs[2], "topic"));
+}
+
+BOOST_AUTO_TEST_CASE(server_closes_idle_clients_despite_answered_pings)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.pingInterval = std::chrono::milliseconds(100);
+    options.idleTimeout = std::chrono::milliseconds(500);
+    Server server{options};
+    server.handleText([](const ws::Request&) { return ""; });
+
+    ws::Client idle;
+    ws::Client active;
+    connect(idle, server);
+    connect(active, server);
+    BOOST_REQUIRE_EQUAL(server.getConnectionCount(), 2);
+
+    // the idle client answers the pings, but never sends a message
+    const auto end =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(1500);
+    while (std::chrono::steady_clock::now() < end)
+    {
+        active.sendText("still here");
+        server.process(10);
+        idle.process(10);
+        active.process(10);
+    }
+    BOOST_CHECK_EQUAL(server.getConnectionCount(), 1);
+}
+
+BOOST_AUTO_TEST_CASE(server_replaces_unsent_frames_with_newest)
+{
+    Server server{"", wsProtocol};
+    uintptr_t clientID = 0;
+    server.handleOpen([&](const uintptr_t id) {
+        clientID = id;
+        return std::vector<ws::Response>{};
+    });
+
+    ws::Client client;
+    std::vector<std::string> frames;
+    client.handleBinary([&](const ws::Request& request) {
+        frames.push_back(request.message);
+        return "";
+    });
+    connect(client, server);
+
+    // the server does not write before process(), only the last frame stays
+    for (char i = '0'; i <= '9'; ++i)
+        server.broadcastFrame("image", &i, 1);
+    for (int i = 0; i < 10; ++i)
+    {
+        server.process(10);
+        client.process(10);
+    }
+
+    BOOST_REQUIRE_EQUAL(frames.size(), 1);
+    BOOST_CHECK_EQUAL(frames[0], "9");
+    const auto stats = server.getFrameStats(clientID);
+    BOOST_CHECK_EQUAL(stats.sent, 1);
+    BOOST_CHECK_EQUAL(stats.skipped, 9);
+    BOOST_CHECK_EQUAL(server.getFrameStats(0).sent, 0);
+}
+
+BOOST_AUTO_TEST_CASE(text_messages_overtake_queued_binary_messages)
+{
+    Server server{"", wsProtocol};
+    ws::Client client;
+    std::vector<ws::Format> received;
+    client.handleText([&](const ws::Request&) {
+        received.push_back(ws::Format::text);
+        return "";
+    });
+    client.handleBinary([&](const ws::Request&) {
+        received.push_back(ws::Format::binary);
+        return "";
+    });
+    connect(client, server);
+
+    const std::string bulk(1024 * 1024, 'x');
+    server.broadcastBinary(bulk.data(), bulk.size());
+    server.broadcastText("reply");
+    for (int i = 0; i < 100 && received.size() < 2; ++i)
+    {
+        server.process(10);
+        client.process(10);
+    }
+
+    BOOST_REQUIRE_EQUAL(received.size(), 2);
+    BOOST_CHECK(received[0] == ws::Format::text);
+    BOOST_CHECK(received[1] == ws::Format::binary);
+}
+
+BOOST_AUTO_TEST_CASE(server_handles_single_frame_and_fragmented_message_views)
+{
+    ServerOptions options;
+    options.name = wsProtocol;
+    options.rxBufferSize = 1024; // larger messages are received in parts
+    Server server{options};
+    std::vector<std::string> received;
+    server.handleTextView([&](const ws::MessageView& view) {
+        received.emplace_back(view.data, view.size);
+        return ws::Response{"size " + std::to_string(view.size)};
+    });
+
+    ws::Client client;
+    std::vector<std::string> replies;
+    client.handleText([&](const ws::Request& request) {
+        replies.push_back(request.message);
+        return "";
+    });
+    connect(client, server);
+
+    const std::string large(10000, 'l');
+    client.sendText("small");
+    client.sendText(large);
+    for (int i = 0; i < 100 && replies.size() < 2; ++i)
+    {
+        client.process(10);
+        server.process(10);
+    }
+
+    BOOST_REQUIRE_EQUAL(received.size(), 2);
+    BOOST_CHECK_EQUAL(received[0], "small");
+    BOOST_CHECK(received[1] == large);
+    BOOST_REQUIRE_EQUAL(replies.size(), 2);
+    BOOST_CHECK_EQUAL(replies[1], "size 10000");
+}